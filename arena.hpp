@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include "int.hpp"
+
+
+// monotonic bump allocator: allocations are never freed one by one, reset() releases all of them at once
+template<size_t capacity, size_t alignment = alignof(std::max_align_t)> requires (capacity > 0 && (alignment & (alignment - 1)) == 0)
+class arena {
+    private:
+        using Self = arena<capacity, alignment>;
+
+        struct block_deleter {
+            void operator()(std::byte* p) const { ::operator delete(p, std::align_val_t(alignment)); }
+        };
+
+    public:
+        arena() : block(static_cast<std::byte*>(::operator new(capacity, std::align_val_t(alignment)))), offset(0) {}
+        arena(const Self&) = delete;
+        Self& operator=(const Self&) = delete;
+        // a moved-from arena has no block and stays exhausted, reset() included
+        arena(Self&& other) : block(std::move(other.block)), offset(std::exchange(other.offset, capacity)) {}
+        Self& operator=(Self&& other) {
+            if (this != &other) {
+                block = std::move(other.block);
+                offset = std::exchange(other.offset, capacity);
+            }
+            return *this;
+        }
+
+        // hands out count objects of T, default constructed, or nothing once the arena is exhausted
+        template<typename T, size_t count = 1, size_t align = alignof(T)>
+            requires (count > 0 && std::is_trivially_destructible_v<T> && align >= alignof(T) && (align & (align - 1)) == 0)
+        std::optional<safe_ptr<T, 0, count>> allocate() {
+            std::uintptr_t base = reinterpret_cast<std::uintptr_t>(block.get());
+            std::uintptr_t first = (base + offset + (align - 1)) & ~static_cast<std::uintptr_t>(align - 1);
+            size_t end = (first - base) + count * sizeof(T);
+            if (end > capacity) return std::nullopt;
+
+            offset = end;
+            T* objects = reinterpret_cast<T*>(first);
+            std::uninitialized_default_construct_n(objects, count);
+            return safe_ptr<T, 0, count>(std::launder(objects));
+        }
+
+        void reset() { offset = block ? 0 : capacity; }
+
+        size_t used() const { return offset; }
+        size_t remaining() const { return capacity - offset; }
+
+        // one arena per thread and per capacity/alignment, created on first use
+        static Self& this_thread() {
+            thread_local Self instance;
+            return instance;
+        }
+
+    private:
+        std::unique_ptr<std::byte[], block_deleter> block;
+        size_t offset;
+};
@@ -0,0 +1,131 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include "int.hpp"
+
+
+inline constexpr size_t cache_line_size = 64;
+
+namespace detail {
+
+    template<typename>
+    struct atomic_bounds;
+
+    template<signed_int T, T n>
+    struct atomic_bounds<LessThanEq<T, n>> {
+        using type = T;
+        static constexpr bool may_decrease = true;
+        static constexpr bool may_increase = false;
+    };
+
+    template<signed_int T, T n>
+    struct atomic_bounds<GreaterThanEq<T, n>> {
+        using type = T;
+        static constexpr bool may_decrease = false;
+        static constexpr bool may_increase = true;
+    };
+
+    template<signed_int T, T n, T m>
+    struct atomic_bounds<InRange<T, n, m>> {
+        using type = T;
+        static constexpr bool may_decrease = false;
+        static constexpr bool may_increase = false;
+    };
+}
+
+
+// lock-free counterpart of LessThanEq, GreaterThanEq and InRange. Every update goes through a CAS loop that never
+// publishes a value outside of the constraint or one that overflowed T: a plain fetch_add would only be safe if the
+// bounds ruled out overflow, and a one-sided bound says nothing about how close the value is to the other end of T.
+template<typename Constrained, bool padded = false>
+class alignas(padded ? cache_line_size : alignof(std::atomic<typename detail::atomic_bounds<Constrained>::type>)) atomic_constrained {
+    private:
+        using T = typename detail::atomic_bounds<Constrained>::type;
+        using Bounds = detail::atomic_bounds<Constrained>;
+        using Self = atomic_constrained<Constrained, padded>;
+
+        static Constrained typed(T x) { return N<T>(x).template assume<Constrained>(); }
+
+    public:
+        atomic_constrained() : value(static_cast<T>(Constrained())) {}
+        atomic_constrained(Constrained x) : value(static_cast<T>(x)) {}
+        atomic_constrained(const Self&) = delete;
+        Self& operator=(const Self&) = delete;
+
+        static constexpr bool is_always_lock_free = std::atomic<T>::is_always_lock_free;
+
+        Constrained load(std::memory_order order = std::memory_order_seq_cst) const {
+            return typed(value.load(order));
+        }
+        void store(Constrained x, std::memory_order order = std::memory_order_seq_cst) {
+            value.store(static_cast<T>(x), order);
+        }
+        Constrained exchange(Constrained x, std::memory_order order = std::memory_order_seq_cst) {
+            return typed(value.exchange(static_cast<T>(x), order));
+        }
+        bool compare_exchange_weak(Constrained& expected, Constrained desired,
+                std::memory_order success = std::memory_order_seq_cst, std::memory_order failure = std::memory_order_seq_cst) {
+            T e = static_cast<T>(expected);
+            bool exchanged = value.compare_exchange_weak(e, static_cast<T>(desired), success, failure);
+            expected = typed(e);
+            return exchanged;
+        }
+
+        // only offered where moving in that direction can't leave the constraint. Returns the previous value, or
+        // nothing (leaving the value as it is) if the result would overflow T.
+        template<signed_int TT, TT nn> requires (Bounds::may_increase && nn >= 0)
+        std::optional<Constrained> fetch_add(GreaterThanEq<TT, nn> y, std::memory_order order = std::memory_order_seq_cst) {
+            return fetch_update<true>(static_cast<T>(y), order);
+        }
+        template<signed_int TT, TT nn, TT mm> requires (Bounds::may_increase && nn >= 0)
+        std::optional<Constrained> fetch_add(InRange<TT, nn, mm> y, std::memory_order order = std::memory_order_seq_cst) {
+            return fetch_update<true>(static_cast<T>(y), order);
+        }
+        template<signed_int TT, TT nn> requires (Bounds::may_decrease && nn >= 0)
+        std::optional<Constrained> fetch_sub(GreaterThanEq<TT, nn> y, std::memory_order order = std::memory_order_seq_cst) {
+            return fetch_update<false>(static_cast<T>(y), order);
+        }
+        template<signed_int TT, TT nn, TT mm> requires (Bounds::may_decrease && nn >= 0)
+        std::optional<Constrained> fetch_sub(InRange<TT, nn, mm> y, std::memory_order order = std::memory_order_seq_cst) {
+            return fetch_update<false>(static_cast<T>(y), order);
+        }
+
+        // lock-free, fails without modifying the value if the result would violate the constraint (or overflow T)
+        bool try_increment(T y, std::memory_order order = std::memory_order_seq_cst) {
+            T current = value.load(std::memory_order_relaxed);
+            T next;
+            do {
+                if (detail::add_overflows(current, y)) return false;
+                next = current + y;
+                if (!Constrained::is_valid(next)) return false;
+            } while (!value.compare_exchange_weak(current, next, order, std::memory_order_relaxed));
+            return true;
+        }
+        bool try_decrement(T y, std::memory_order order = std::memory_order_seq_cst) {
+            T current = value.load(std::memory_order_relaxed);
+            T next;
+            do {
+                if (detail::sub_overflows(current, y)) return false;
+                next = current - y;
+                if (!Constrained::is_valid(next)) return false;
+            } while (!value.compare_exchange_weak(current, next, order, std::memory_order_relaxed));
+            return true;
+        }
+
+    private:
+        template<bool add>
+        std::optional<Constrained> fetch_update(T y, std::memory_order order) {
+            T current = value.load(std::memory_order_relaxed);
+            T next;
+            do {
+                if (add ? detail::add_overflows(current, y) : detail::sub_overflows(current, y)) return std::nullopt;
+                next = add ? current + y : current - y;
+            } while (!value.compare_exchange_weak(current, next, order, std::memory_order_relaxed));
+            return typed(current);
+        }
+
+        std::atomic<T> value;
+};
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <type_traits>
+#include "int.hpp"
+
+
+// f evaluated over a whole constrained domain at compile time. Lookups are a single check-free load, and for integral
+// results (signed or unsigned, bool aside) the returned value is constrained to the min/max of f over the (sub)domain of
+// the argument. Unsigned domains have to be non-wrapping.
+template<auto f, typename Domain>
+class constexpr_table;
+
+template<auto f, std::integral T, T n, T m> requires (n <= m)
+class constexpr_table<f, InRange<T, n, m>> {
+    public:
+        using result_type = std::remove_cvref_t<decltype(f(n))>;
+        static constexpr size_t size = static_cast<size_t>(m - n) + 1;
+
+    private:
+        static constexpr safe_array<result_type, size> values = [] {
+            safe_array<result_type, size> table{};
+            for (size_t i = 0; i < size; i++) {
+                table.data()[i] = f(static_cast<T>(n + static_cast<T>(i)));
+            }
+            return table;
+        }();
+
+        template<T nn, T mm>
+        static constexpr result_type min_over() {
+            result_type r = values.data()[nn - n];
+            for (size_t i = nn - n; i <= static_cast<size_t>(mm - n); i++) {
+                if (values.data()[i] < r) r = values.data()[i];
+            }
+            return r;
+        }
+
+        template<T nn, T mm>
+        static constexpr result_type max_over() {
+            result_type r = values.data()[nn - n];
+            for (size_t i = nn - n; i <= static_cast<size_t>(mm - n); i++) {
+                if (values.data()[i] > r) r = values.data()[i];
+            }
+            return r;
+        }
+
+    public:
+        template<T nn, T mm> requires (nn >= n && nn <= mm && mm <= m)
+        static constexpr auto lookup(InRange<T, nn, mm> x) {
+            T offset = static_cast<T>(x) - n;
+            auto i = N<size_t>(static_cast<size_t>(offset)).template assume_in_range<nn - n, mm - n>();
+            if constexpr (signed_int<result_type>) {
+                return N<result_type>(values[i]).template assume<InRange<result_type, min_over<nn, mm>(), max_over<nn, mm>()>>();
+            } else if constexpr (unsigned_int<result_type> && !std::is_same_v<result_type, bool>) {
+                return N<result_type>(values[i]).template assume_in_range<min_over<nn, mm>(), max_over<nn, mm>()>();
+            } else {
+                return values[i];
+            }
+        }
+
+        template<T nn, T mm> requires (nn >= n && nn <= mm && mm <= m)
+        constexpr auto operator()(InRange<T, nn, mm> x) const {
+            return lookup(x);
+        }
+};
@@ -0,0 +1,114 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "int.hpp"
+
+
+namespace detail {
+
+    template<typename>
+    struct dispatch_domain {
+        static constexpr bool valid = false;
+    };
+
+    template<std::integral T, T n, T m> requires (n <= m)
+    struct dispatch_domain<InRange<T, n, m>> {
+        static constexpr bool valid = true;
+        using type = T;
+        static constexpr T first = n;
+        static constexpr size_t size = static_cast<size_t>(m - n) + 1;
+
+        static size_t offset(InRange<T, n, m> x) { return static_cast<size_t>(static_cast<T>(x) - n); }
+
+        template<size_t i>
+        static constexpr InRange<T, n + static_cast<T>(i), n + static_cast<T>(i)> value() {
+            return ::constant<T, n + static_cast<T>(i)>;
+        }
+    };
+
+    // the last dimension varies fastest
+    template<size_t d, typename... Ds>
+    constexpr size_t dispatch_stride() {
+        constexpr size_t sizes[] = { dispatch_domain<Ds>::size... };
+        size_t stride = 1;
+        for (size_t k = d + 1; k < sizeof...(Ds); k++) stride *= sizes[k];
+        return stride;
+    }
+
+    template<size_t d, size_t flat, typename... Ds>
+    constexpr size_t dispatch_coordinate() {
+        using D = std::tuple_element_t<d, std::tuple<Ds...>>;
+        return (flat / dispatch_stride<d, Ds...>()) % dispatch_domain<D>::size;
+    }
+
+    template<typename F, size_t flat, typename... Ds, size_t... d>
+    decltype(auto) dispatch_invoke(F& f, std::index_sequence<d...>) {
+        return std::invoke(f, dispatch_domain<Ds>::template value<dispatch_coordinate<d, flat, Ds...>()>()...);
+    }
+
+    template<typename F, typename... Ds>
+    struct dispatch_table {
+        static constexpr size_t size = (dispatch_domain<Ds>::size * ...);
+        using dims = std::index_sequence_for<Ds...>;
+
+        template<size_t flat>
+        using result_at = decltype(dispatch_invoke<F, flat, Ds...>(std::declval<F&>(), dims{}));
+
+        template<size_t... flat>
+        static constexpr bool same_result(std::index_sequence<flat...>) {
+            return (std::is_same_v<result_at<flat>, result_at<0>> && ...);
+        }
+
+        // every entry of the table has the same signature, references included
+        using result_type = result_at<0>;
+        static_assert(same_result(std::make_index_sequence<size>{}),
+            "dispatch needs f to return the same type for every value in the domain (convert differently bounded results inside f)");
+        using entry = result_type(*)(F&);
+
+        template<size_t flat>
+        static result_type call(F& f) {
+            return dispatch_invoke<F, flat, Ds...>(f, dims{});
+        }
+
+        template<size_t... flat>
+        static constexpr safe_array<entry, size> make(std::index_sequence<flat...>) {
+            const entry list[] = { &call<flat>... };
+            safe_array<entry, size> table{};
+            for (size_t i = 0; i < size; i++) table.data()[i] = list[i];
+            return table;
+        }
+        static constexpr safe_array<entry, size> entries = make(std::make_index_sequence<size>{});
+
+        template<size_t... d>
+        static size_t flat_index(const Ds&... xs, std::index_sequence<d...>) {
+            return ((dispatch_domain<Ds>::offset(xs) * dispatch_stride<d, Ds...>()) + ...);
+        }
+    };
+
+    template<typename F, typename... Ds>
+    decltype(auto) dispatch_impl(F& f, Ds... xs) {
+        static_assert((dispatch_domain<Ds>::valid && ...), "dispatch needs InRange arguments followed by the callable");
+        using table = dispatch_table<F, Ds...>;
+        auto i = N<size_t>(table::flat_index(xs..., typename table::dims{})).template assume_in_range<0, table::size - 1>();
+        return table::entries[i](f);
+    }
+
+    template<typename Tuple, size_t... d>
+    decltype(auto) dispatch_unpack(Tuple&& args, std::index_sequence<d...>) {
+        constexpr size_t last = std::tuple_size_v<std::remove_reference_t<Tuple>> - 1;
+        return dispatch_impl(std::get<last>(args), std::get<d>(args)...);
+    }
+}
+
+
+// dispatch(x, y, ..., f) calls f(constant<T, i>, constant<TT, j>, ...) for the values currently held by x, y, ...
+// All combinations are instantiated up front and picked through one table indexed by the (already proven in range)
+// values, so there is no switch and no range check. f has to return the same type for every combination, which is
+// then passed through as is (references included).
+template<typename... Args> requires (sizeof...(Args) >= 2)
+decltype(auto) dispatch(Args&&... args) {
+    return detail::dispatch_unpack(std::forward_as_tuple(std::forward<Args>(args)...), std::make_index_sequence<sizeof...(Args) - 1>{});
+}
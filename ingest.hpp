@@ -0,0 +1,331 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <istream>
+#include <memory>
+#include <semaphore>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
+#include "int.hpp"
+#include "packed_struct.hpp"
+#include "simd.hpp"
+
+
+// sources hand out raw bytes. A short read means the input has ended (or failed, which failed() tells apart).
+
+class istream_source {
+    public:
+        istream_source(std::istream& in) : in(in) {}
+
+        size_t operator()(std::byte* buffer, size_t size) {
+            in.read(reinterpret_cast<char*>(buffer), static_cast<std::streamsize>(size));
+            return static_cast<size_t>(in.gcount());
+        }
+        bool failed() const { return in.bad(); }
+
+    private:
+        std::istream& in;
+};
+
+class fd_source {
+    public:
+        fd_source(int fd) : fd(fd), error(false) {}
+
+        size_t operator()(std::byte* buffer, size_t size) {
+            size_t done = 0;
+            while (done < size) {
+                ssize_t got = ::read(fd, buffer + done, size - done);
+                if (got == 0) break;
+                if (got < 0) {
+                    if (errno == EINTR) continue;
+                    error = true;
+                    break;
+                }
+                done += static_cast<size_t>(got);
+            }
+            return done;
+        }
+        bool failed() const { return error; }
+
+    private:
+        int fd;
+        bool error;
+};
+
+
+struct ingest_stats {
+    uint64_t bytes_read = 0;
+    uint64_t rows_accepted = 0;
+    uint64_t rows_rejected = 0;
+    uint64_t blocks = 0;
+    uint64_t trailing_bytes = 0;   // an incomplete last row
+    bool read_failed = false;
+    std::chrono::nanoseconds read_time{0};
+    std::chrono::nanoseconds validate_time{0};
+    std::chrono::nanoseconds consume_time{0};
+
+    // validation only, the figure to watch while tuning block_rows against the L2 size
+    double validated_bytes_per_second() const {
+        return validate_time.count() == 0 ? 0.0 : static_cast<double>(bytes_read) * 1e9 / static_cast<double>(validate_time.count());
+    }
+};
+
+namespace detail {
+
+    // how a column arrives in the raw record and how its values are checked
+    template<typename>
+    struct ingest_column;
+
+    template<std::integral T, T n, T m>
+    struct ingest_column<InRange<T, n, m>> {
+        using raw_type = T;
+        static bool valid(T x) { return InRange<T, n, m>::is_valid(x); }
+    };
+
+    template<>
+    struct ingest_column<bool> {
+        using raw_type = uint8_t;
+        static bool valid(uint8_t x) { return x <= 1; }
+    };
+
+    template<typename>
+    struct lane_of {
+        using type = bool;
+    };
+
+    template<std::integral T, T n, T m>
+    struct lane_of<InRange<T, n, m>> {
+        using type = T;
+    };
+
+    struct ignore_rejects {
+        void operator()(uint64_t, const std::byte*) const {}
+    };
+}
+
+
+// a validated block: the first `rows` entries of every column hold accepted rows, in input order
+template<size_t block_rows, typename... Fields>
+struct ingest_block {
+    packed_columns<block_rows, Fields...> columns;
+    InRange<size_t, 0, block_rows> rows;
+};
+
+// turns a stream of fixed size records (the raw types of Fields back to back, native byte order, no padding) into
+// ingest_blocks. A reader thread fills one raw buffer while the other one is validated, and validation itself is
+// column at a time: a record is split into per field arrays, every array is range checked in one branch free pass,
+// and the accepted rows are compacted into the block without branching on the result either. Rejected records go
+// to the reject callback as raw bytes, together with their record number in the stream.
+template<size_t block_rows, typename... Fields> requires (block_rows > 0 && sizeof...(Fields) > 0)
+class block_ingest {
+    private:
+        template<typename F>
+        using raw_t = typename detail::ingest_column<typename F::type>::raw_type;
+
+    public:
+        using block_type = ingest_block<block_rows, Fields...>;
+
+        static constexpr size_t row_bytes = (sizeof(raw_t<Fields>) + ... + 0);
+        static constexpr size_t block_bytes = row_bytes * block_rows;
+        // both raw buffers, the split columns, the row masks and the block
+        static constexpr size_t working_set_bytes = 3 * block_bytes + block_rows + sizeof(block_type);
+
+        block_ingest()
+            : raw(std::make_unique<std::byte[]>(2 * block_bytes)), split(std::make_unique<raw_t<Fields>[]>(block_rows)...),
+              valid(std::make_unique<uint8_t[]>(block_rows)), block(std::make_unique<block_type>()) {}
+
+        // blocks until the source is drained. consume(const block_type&) runs on the calling thread while the next
+        // chunk is being read, reject(uint64_t record, const std::byte* row) gets row_bytes bytes per rejected record.
+        // If the source, consume or reject throws, the reader is stopped and joined and the exception is rethrown here.
+        template<typename Source, typename Consume, typename Reject = detail::ignore_rejects>
+        ingest_stats run(Source& source, Consume consume, Reject reject = {}) {
+            // empty[] may be released once more than it is acquired when a run is cut short, hence the room for 2
+            std::counting_semaphore<2> empty[2] = { std::counting_semaphore<2>(1), std::counting_semaphore<2>(1) };
+            std::binary_semaphore full[2] = { std::binary_semaphore(0), std::binary_semaphore(0) };
+            size_t filled[2] = { 0, 0 };
+            std::atomic<bool> stop(false);
+            // handed over together with the slot that the failed read was meant for
+            std::exception_ptr read_error[2];
+
+            std::thread reader([&] {
+                for (size_t slot = 0;; slot ^= 1) {
+                    empty[slot].acquire();
+                    if (stop.load(std::memory_order_relaxed)) return;
+                    bool last;
+                    try {
+                        auto start = clock::now();
+                        filled[slot] = source(raw.get() + slot * block_bytes, block_bytes);
+                        counters.read_ns.fetch_add(elapsed(start), std::memory_order_relaxed);
+                        counters.bytes_read.fetch_add(filled[slot], std::memory_order_relaxed);
+                        last = filled[slot] < block_bytes;
+                    } catch (...) {
+                        read_error[slot] = std::current_exception();
+                        last = true;
+                    }
+                    full[slot].release();
+                    if (last) return;
+                }
+            });
+
+            std::exception_ptr error;
+            try {
+                uint64_t record = 0;
+                for (size_t slot = 0;; slot ^= 1) {
+                    full[slot].acquire();
+                    if (read_error[slot]) {
+                        error = read_error[slot];
+                        break;
+                    }
+                    size_t bytes = filled[slot];
+                    size_t rows = bytes / row_bytes;
+
+                    auto start = clock::now();
+                    validate(raw.get() + slot * block_bytes, rows, record, reject);
+                    counters.validate_ns.fetch_add(elapsed(start), std::memory_order_relaxed);
+                    record += rows;
+                    empty[slot].release();
+
+                    if (block->rows > 0) {
+                        start = clock::now();
+                        consume(static_cast<const block_type&>(*block));
+                        counters.consume_ns.fetch_add(elapsed(start), std::memory_order_relaxed);
+                        counters.blocks.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    if (bytes < block_bytes) {
+                        counters.trailing_bytes.fetch_add(bytes % row_bytes, std::memory_order_relaxed);
+                        break;
+                    }
+                }
+            } catch (...) {
+                // the reader is either reading (and then waits on empty[]) or already waiting, either way it wakes up
+                // to the stop flag
+                stop.store(true, std::memory_order_relaxed);
+                empty[0].release();
+                empty[1].release();
+                reader.join();
+                throw;
+            }
+            reader.join();
+            if (error) std::rethrow_exception(error);
+            if (source.failed()) counters.read_failed.store(true, std::memory_order_relaxed);
+            return stats();
+        }
+
+        template<typename Source, typename Consume, typename Reject = detail::ignore_rejects>
+        ingest_stats run(Source&& source, Consume consume, Reject reject = {}) requires (!std::is_lvalue_reference_v<Source>) {
+            return run(source, consume, reject);
+        }
+
+        // cumulative over all runs, safe to call from consume or any other thread while a run is going on
+        ingest_stats stats() const {
+            ingest_stats s;
+            s.bytes_read = counters.bytes_read.load(std::memory_order_relaxed);
+            s.rows_accepted = counters.rows_accepted.load(std::memory_order_relaxed);
+            s.rows_rejected = counters.rows_rejected.load(std::memory_order_relaxed);
+            s.blocks = counters.blocks.load(std::memory_order_relaxed);
+            s.trailing_bytes = counters.trailing_bytes.load(std::memory_order_relaxed);
+            s.read_failed = counters.read_failed.load(std::memory_order_relaxed);
+            s.read_time = std::chrono::nanoseconds(counters.read_ns.load(std::memory_order_relaxed));
+            s.validate_time = std::chrono::nanoseconds(counters.validate_ns.load(std::memory_order_relaxed));
+            s.consume_time = std::chrono::nanoseconds(counters.consume_ns.load(std::memory_order_relaxed));
+            return s;
+        }
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        static uint64_t elapsed(clock::time_point start) {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count());
+        }
+
+        template<size_t i>
+        static constexpr size_t field_offset = [] {
+            constexpr size_t sizes[] = { sizeof(raw_t<Fields>)... };
+            size_t offset = 0;
+            for (size_t j = 0; j < i; j++) offset += sizes[j];
+            return offset;
+        }();
+
+        template<typename Reject>
+        void validate(const std::byte* rows_in, size_t rows, uint64_t first_record, Reject& reject) {
+            std::fill_n(valid.get(), rows, uint8_t(1));
+            [&]<size_t... i>(std::index_sequence<i...>) {
+                (check_column<i, Fields>(rows_in, rows), ...);
+            }(std::index_sequence_for<Fields...>{});
+
+            size_t accepted = 0;
+            for (size_t r = 0; r < rows; r++) accepted += valid[r];
+
+            [&]<size_t... i>(std::index_sequence<i...>) {
+                (compact_column<i, Fields>(rows, accepted), ...);
+            }(std::index_sequence_for<Fields...>{});
+            block->rows = N<size_t>(accepted).template assume_in_range<0, block_rows>();
+
+            if (accepted < rows) {
+                for (size_t r = 0; r < rows; r++) {
+                    if (!valid[r]) reject(first_record + r, rows_in + r * row_bytes);
+                }
+            }
+            counters.rows_accepted.fetch_add(accepted, std::memory_order_relaxed);
+            counters.rows_rejected.fetch_add(rows - accepted, std::memory_order_relaxed);
+        }
+
+        // field i of every row into its own array, then one pass over that array
+        template<size_t i, typename F>
+        void check_column(const std::byte* rows_in, size_t rows) {
+            using R = raw_t<F>;
+            R* column = std::get<i>(split).get();
+            for (size_t r = 0; r < rows; r++) {
+                std::memcpy(&column[r], rows_in + r * row_bytes + field_offset<i>, sizeof(R));
+            }
+            uint8_t* ok = valid.get();
+            for (size_t r = 0; r < rows; r++) {
+                ok[r] &= static_cast<uint8_t>(detail::ingest_column<typename F::type>::valid(column[r]));
+            }
+        }
+
+        // every row is written to the current output position, which only moves on past accepted rows. That leaves
+        // at most one rejected value behind (at position `accepted`), which is put back to a valid value afterwards.
+        template<size_t i, typename F>
+        void compact_column(size_t rows, size_t accepted) {
+            using R = raw_t<F>;
+            using E = detail::column_type<typename F::type>;
+            using L = typename detail::lane_of<E>::type;
+            static_assert(detail::is_lane_compatible<E, L>);
+
+            auto& column = block->columns.template column<F::name>();
+            L* out = reinterpret_cast<L*>(column.data());
+            const R* in = std::get<i>(split).get();
+            const uint8_t* ok = valid.get();
+            size_t position = 0;
+            for (size_t r = 0; r < rows; r++) {
+                out[position] = static_cast<L>(in[r]);
+                position += ok[r];
+            }
+            if (accepted < rows) column.data()[accepted] = E();
+        }
+
+        struct {
+            std::atomic<uint64_t> bytes_read{0};
+            std::atomic<uint64_t> rows_accepted{0};
+            std::atomic<uint64_t> rows_rejected{0};
+            std::atomic<uint64_t> blocks{0};
+            std::atomic<uint64_t> trailing_bytes{0};
+            std::atomic<bool> read_failed{false};
+            std::atomic<uint64_t> read_ns{0};
+            std::atomic<uint64_t> validate_ns{0};
+            std::atomic<uint64_t> consume_ns{0};
+        } counters;
+
+        std::unique_ptr<std::byte[]> raw;
+        std::tuple<std::unique_ptr<raw_t<Fields>[]>...> split;
+        std::unique_ptr<uint8_t[]> valid;
+        std::unique_ptr<block_type> block;
+};
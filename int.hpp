@@ -1,10 +1,14 @@
-
+#pragma once
 #include <array>
+#include <bit>
 #include <concepts>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <limits>
 #include <type_traits>
 #include <optional>
+#include <utility>
 
 
 #if __cplusplus == 202302L
@@ -33,6 +37,110 @@ concept has_validator = requires(TT tt) {
     { T::is_valid(tt) } -> std::convertible_to<bool>;
 };
 
+template<long long lo, long long hi>
+using narrowest_signed_t =
+    std::conditional_t<(lo >= std::numeric_limits<int8_t>::min() && hi <= std::numeric_limits<int8_t>::max()), int8_t,
+    std::conditional_t<(lo >= std::numeric_limits<int16_t>::min() && hi <= std::numeric_limits<int16_t>::max()), int16_t,
+    std::conditional_t<(lo >= std::numeric_limits<int32_t>::min() && hi <= std::numeric_limits<int32_t>::max()), int32_t, int64_t>>>;
+
+template<unsigned long long hi>
+using narrowest_unsigned_t =
+    std::conditional_t<(hi <= std::numeric_limits<uint8_t>::max()), uint8_t,
+    std::conditional_t<(hi <= std::numeric_limits<uint16_t>::max()), uint16_t,
+    std::conditional_t<(hi <= std::numeric_limits<uint32_t>::max()), uint32_t, uint64_t>>>;
+
+// Underlying type of the result of arithmetic on constrained values with the bounds [lo, hi] (long long for signed
+// operands, unsigned long long for unsigned ones). The operators use the common type of the operands (the wider one
+// for unsigned operands), narrowing_add/narrowing_sub the narrowest type of the same signedness that holds the
+// bounds. Either way they only exist if the bounds fit.
+template<std::integral T, std::integral TT, auto lo, auto hi, bool narrowing = false>
+struct arithmetic_result {
+    private:
+        static auto pick() {
+            if constexpr (std::is_signed_v<T>) {
+                if constexpr (narrowing) return narrowest_signed_t<lo, hi>{};
+                else return std::common_type_t<T, TT>{};
+            } else {
+                if constexpr (narrowing) return narrowest_unsigned_t<hi>{};
+                else return std::conditional_t<(sizeof(TT) > sizeof(T)), TT, T>{};
+            }
+        }
+    public:
+        using type = decltype(pick());
+        static constexpr bool fits = std::in_range<type>(lo) && std::in_range<type>(hi);
+};
+
+// Unsigned ranges are intervals on the ring of 2^bits values, InRange<uint8_t, 250, 3> is 250, ..., 255, 0, ..., 3.
+
+// x modulo size, where a size of 0 stands for all 2^bits values. A single mask whenever size is a power of two.
+template<unsigned_int T, T size>
+constexpr T reduce_modulo(T x) {
+    if constexpr (size == 0) return x;
+    else if constexpr (std::has_single_bit(size)) return static_cast<T>(x & static_cast<T>(size - 1));
+    else return static_cast<T>(x % size);
+}
+
+// whether every value of the interval [n, m] of T lies in the interval [nn, mm] of TT. An interval that wraps around
+// is only contiguous in its own width, so it can't move to a type of another size.
+template<unsigned_int T, unsigned_int TT>
+constexpr bool unsigned_range_within(T n, T m, TT nn, TT mm) {
+    if (n > m && sizeof(T) != sizeof(TT)) return false;
+    if (!std::in_range<TT>(n) || !std::in_range<TT>(m)) return false;
+    if (static_cast<TT>(mm - nn) == std::numeric_limits<TT>::max()) return true;
+    TT offset = static_cast<TT>(static_cast<TT>(n) - nn);
+    TT span = static_cast<TT>(static_cast<TT>(m) - static_cast<TT>(n));
+    TT target = static_cast<TT>(mm - nn);
+    return offset <= target && span <= static_cast<TT>(target - offset);
+}
+
+namespace detail {
+
+    // whether x (op) y leaves T. The builtins where the compiler has them, plain limit checks everywhere else.
+    template<signed_int T>
+    constexpr bool add_overflows(T x, T y) {
+#if defined(__GNUC__) || defined(__clang__)
+        T r;
+        return __builtin_add_overflow(x, y, &r);
+#else
+        return y > 0 ? x > std::numeric_limits<T>::max() - y : x < std::numeric_limits<T>::min() - y;
+#endif
+    }
+
+    template<signed_int T>
+    constexpr bool sub_overflows(T x, T y) {
+#if defined(__GNUC__) || defined(__clang__)
+        T r;
+        return __builtin_sub_overflow(x, y, &r);
+#else
+        return y < 0 ? x > std::numeric_limits<T>::max() + y : x < std::numeric_limits<T>::min() + y;
+#endif
+    }
+
+    template<signed_int T>
+    constexpr bool mul_overflows(T x, T y) {
+#if defined(__GNUC__) || defined(__clang__)
+        T r;
+        return __builtin_mul_overflow(x, y, &r);
+#else
+        if (x == 0 || y == 0) return false;
+        if (x > 0) return y > 0 ? x > std::numeric_limits<T>::max() / y : y < std::numeric_limits<T>::min() / x;
+        return y > 0 ? x < std::numeric_limits<T>::min() / y : y < std::numeric_limits<T>::max() / x;
+#endif
+    }
+
+    // bounds of results are worked out in long long, so bounds that leave T (or long long) fail a requires clause
+    // instead of overflowing in a constant expression
+    template<signed_int T>
+    constexpr bool sum_fits(long long a, long long b) { return !add_overflows(a, b) && std::in_range<T>(a + b); }
+    template<signed_int T>
+    constexpr bool difference_fits(long long a, long long b) { return !sub_overflows(a, b) && std::in_range<T>(a - b); }
+
+    template<signed_int T>
+    constexpr T bound_sum(long long a, long long b) { return sum_fits<T>(a, b) ? static_cast<T>(a + b) : T(0); }
+    template<signed_int T>
+    constexpr T bound_difference(long long a, long long b) { return difference_fits<T>(a, b) ? static_cast<T>(a - b) : T(0); }
+}
+
 template<signed_int T, typename Derived>
 class SafeInPlaceOps {
     private:
@@ -51,6 +159,7 @@ class SafeInPlaceOps {
         Derived& divide_unsafe(T y) { _x() /= y; return as_derived(); }
 
         bool try_decrement(T y) {
+            if (detail::sub_overflows(_x(), y)) return false;
             T diff = _x() - y;
             if (!Derived::is_valid(diff)) return false;
             
@@ -58,13 +167,15 @@ class SafeInPlaceOps {
             return true;
         }
         bool try_increment(T y) {
-            int sum = _x() + y;
+            if (detail::add_overflows(_x(), y)) return false;
+            T sum = _x() + y;
             if (!Derived::is_valid(sum)) return false;
 
             _x() = sum;
             return true;
         }
         bool try_multiply(T y) {
+            if (detail::mul_overflows(_x(), y)) return false;
             T prod = _x() * y;
             if (!Derived::is_valid(prod)) return false;
             
@@ -72,7 +183,8 @@ class SafeInPlaceOps {
             return true;
         }
         bool try_divide(T y) {
-            int quot = _x() / y;
+            if (y == 0 || (y == -1 && _x() == std::numeric_limits<T>::min())) return false;
+            T quot = _x() / y;
             if (!Derived::is_valid(quot)) return false;
 
             _x() = quot;
@@ -93,6 +205,26 @@ class GreaterThanEq;
 template<std::integral T, T n, T m>
 class InRange {};
 
+// bounds of x + y and x - y for x in [n, m] and y in [nn, mm], computed in the wider of the two types. The spans add
+// up, once they reach 2^bits the result can be anything and is typed as the unconstrained InRange<W, 0, max>.
+template<unsigned_int T, T n, T m, unsigned_int TT, TT nn, TT mm>
+struct modular_bounds {
+    using W = std::conditional_t<(sizeof(TT) > sizeof(T)), TT, T>;
+    // arithmetic happens in at least unsigned int, so that narrow operands don't get promoted to int
+    using P = std::common_type_t<W, unsigned>;
+    static constexpr W max = std::numeric_limits<W>::max();
+
+    static constexpr bool representable = unsigned_range_within<T, W>(n, m, 0, max) && unsigned_range_within<TT, W>(nn, mm, 0, max);
+    static constexpr W span = static_cast<W>(static_cast<P>(m) - static_cast<P>(n));
+    static constexpr W other_span = static_cast<W>(static_cast<P>(mm) - static_cast<P>(nn));
+    static constexpr bool covers_all = span > max - other_span;
+
+    using sum = std::conditional_t<covers_all, InRange<W, 0, max>,
+        InRange<W, static_cast<W>(static_cast<P>(n) + static_cast<P>(nn)), static_cast<W>(static_cast<P>(m) + static_cast<P>(mm))>>;
+    using difference = std::conditional_t<covers_all, InRange<W, 0, max>,
+        InRange<W, static_cast<W>(static_cast<P>(n) - static_cast<P>(mm)), static_cast<W>(static_cast<P>(m) - static_cast<P>(nn))>>;
+};
+
 template<signed_int T>
 class Range;
 
@@ -177,12 +309,12 @@ class N<T> {
     public:
         using Self = N<T>;
         constexpr N(T x) : x(x) { static_assert(std::is_trivially_copyable<Self>()); }
-        operator T&() { return x; }
-        operator T&() const { return x; } 
+        constexpr operator T&() { return x; }
+        constexpr operator const T&() const { return x; }
 
         template<T n, T m>
         constexpr InRange<T, n, m> assume_in_range() const {
-            return InRange<T, n, m>(x);
+            return InRange<T, n, m>(*this);
         }
 
         template<has_validator<T> U>
@@ -206,6 +338,24 @@ class N<T> {
             return assume_in_range<n, m>();
         }
 
+        // the value of the domain that is congruent to x modulo its size, e.g. a hash reduced to a bucket index. For
+        // domains of a power of two size that's a single mask, for [0, m] a single modulo.
+        template<T n, T m> requires (n <= m && static_cast<T>(n - 1) != m)
+        constexpr InRange<T, n, m> wrap_in_range() const {
+            constexpr T size = static_cast<T>(m - n + 1);
+            T offset;
+            if constexpr (std::has_single_bit(size)) {
+                offset = reduce_modulo<T, size>(static_cast<T>(x - n));
+            } else if constexpr (n % size == 0) {
+                offset = reduce_modulo<T, size>(x);
+            } else {
+                constexpr T base = n % size;
+                T r = reduce_modulo<T, size>(x);
+                offset = r >= base ? static_cast<T>(r - base) : static_cast<T>(r + (size - base));
+            }
+            return InRange<T, n, m>(N<T>(static_cast<T>(n + offset)));
+        }
+
     protected:
         T x;
 };
@@ -419,6 +569,35 @@ class InRange<T, n, m> : public N<T>, public SafeInPlaceOps<T, InRange<T, n, m>>
         friend class __;
         friend class SafeInPlaceOps<T, InRange<T, n, m>>;
 
+        template<signed_int TT, TT nn, TT mm, bool narrowing>
+        using sum_result = arithmetic_result<T, TT, detail::bound_sum<long long>(n, nn), detail::bound_sum<long long>(m, mm), narrowing>;
+        template<signed_int TT, TT nn, TT mm, bool narrowing>
+        using difference_result = arithmetic_result<T, TT, detail::bound_difference<long long>(n, mm), detail::bound_difference<long long>(m, nn), narrowing>;
+
+        template<signed_int TT, TT nn, TT mm, bool narrowing>
+        static constexpr bool sum_exists = detail::sum_fits<long long>(n, nn) && detail::sum_fits<long long>(m, mm)
+            && sum_result<TT, nn, mm, narrowing>::fits;
+        template<signed_int TT, TT nn, TT mm, bool narrowing>
+        static constexpr bool difference_exists = detail::difference_fits<long long>(n, mm) && detail::difference_fits<long long>(m, nn)
+            && difference_result<TT, nn, mm, narrowing>::fits;
+
+        template<bool narrowing, signed_int TT, TT nn, TT mm>
+        constexpr auto add(InRange<TT, nn, mm> other) const {
+            using B = sum_result<TT, nn, mm, narrowing>;
+            using R = typename B::type;
+            using W = std::common_type_t<T, TT, R>;
+            return InRange<R, static_cast<R>(detail::bound_sum<long long>(n, nn)), static_cast<R>(detail::bound_sum<long long>(m, mm))>(
+                N<R>(static_cast<R>(static_cast<W>(this->x) + static_cast<W>(other.x))));
+        }
+        template<bool narrowing, signed_int TT, TT nn, TT mm>
+        constexpr auto subtract(InRange<TT, nn, mm> other) const {
+            using B = difference_result<TT, nn, mm, narrowing>;
+            using R = typename B::type;
+            using W = std::common_type_t<T, TT, R>;
+            return InRange<R, static_cast<R>(detail::bound_difference<long long>(n, mm)), static_cast<R>(detail::bound_difference<long long>(m, nn))>(
+                N<R>(static_cast<R>(static_cast<W>(this->x) - static_cast<W>(other.x))));
+        }
+
         
         Self operator++(int) { this->x++; return *this; }
         Self& operator++() { this->x++; return *this; }
@@ -435,26 +614,39 @@ class InRange<T, n, m> : public N<T>, public SafeInPlaceOps<T, InRange<T, n, m>>
         constexpr InRange() : N<T>(n) { compiler_hint(); static_assert(std::is_trivially_copyable<Self>()); }
         consteval InRange(T x) : N<T>(x) { compiler_hint(); }
 
-        template<unsigned_int TT>
-        constexpr operator InRange<TT, n, m>() const { return InRange<TT, n, m>(*this); }
+        template<unsigned_int TT> requires (n >= 0 && std::in_range<TT>(m))
+        constexpr operator InRange<TT, n, m>() const { return InRange<TT, n, m>(N<TT>(this->x)); }
 
         template<signed_int TT, TT nn, TT mm> requires (nn <= n && mm >= m)
-        constexpr operator InRange<TT, nn, mm>() const { return InRange<TT, nn, mm>(*this); }
+        constexpr operator InRange<TT, nn, mm>() const { return InRange<TT, nn, mm>(N<TT>(this->x)); }
+
+        constexpr auto narrow() const {
+            using R = narrowest_signed_t<n, m>;
+            return InRange<R, n, m>(N<R>(static_cast<R>(this->x)));
+        }
+        template<signed_int TT> requires (sizeof(TT) >= sizeof(T) && std::in_range<TT>(n) && std::in_range<TT>(m))
+        constexpr InRange<TT, n, m> widen() const { return InRange<TT, n, m>(N<TT>(this->x)); }
+
+        constexpr auto as_unsigned() const requires (n >= 0) {
+            using R = std::make_unsigned_t<T>;
+            return InRange<R, n, m>(N<R>(static_cast<R>(this->x)));
+        }
 
         template<signed_int TT, TT mm> requires (mm >= m)
-        constexpr operator LessThanEq<TT, mm>() const { return LessThanEq<TT, mm>(*this); }
+        constexpr operator LessThanEq<TT, mm>() const { return LessThanEq<TT, mm>(N<TT>(this->x)); }
         template<signed_int TT, TT nn> requires (nn <= n)
-        constexpr operator GreaterThanEq<TT, nn>() const { return GreaterThanEq<TT, nn>(*this); }
+        constexpr operator GreaterThanEq<TT, nn>() const { return GreaterThanEq<TT, nn>(N<TT>(this->x)); }
 
-        template<signed_int TT, TT nn, TT mm>
-        constexpr InRange<std::common_type_t<T, TT>, n + nn, m + mm> operator+(InRange<TT, nn, mm> other) const {
-            return InRange<std::common_type_t<T, TT>, n + nn, m + mm>(N<T>(this->x + other.x));
-        }
+        template<signed_int TT, TT nn, TT mm> requires (sum_exists<TT, nn, mm, false>)
+        constexpr auto operator+(InRange<TT, nn, mm> other) const { return add<false>(other); }
+        template<signed_int TT, TT nn, TT mm> requires (difference_exists<TT, nn, mm, false>)
+        constexpr auto operator-(InRange<TT, nn, mm> other) const { return subtract<false>(other); }
 
-        template<signed_int TT, TT nn, TT mm>
-        constexpr auto operator-(InRange<TT, nn, mm> other) const {
-            return *this + InRange<TT, -mm, -nn>(N<TT>(-other.x));
-        }
+        // same bounds as + and -, but in the narrowest type that holds them
+        template<signed_int TT, TT nn, TT mm> requires (sum_exists<TT, nn, mm, true>)
+        constexpr auto narrowing_add(InRange<TT, nn, mm> other) const { return add<true>(other); }
+        template<signed_int TT, TT nn, TT mm> requires (difference_exists<TT, nn, mm, true>)
+        constexpr auto narrowing_sub(InRange<TT, nn, mm> other) const { return subtract<true>(other); }
 
         template<signed_int TT, T nn>
         constexpr GreaterThanEq<std::common_type_t<T, TT>, nn + n> operator+(GreaterThanEq<TT, nn> other) const {
@@ -482,8 +674,8 @@ class InRange<T, n, m> : public N<T>, public SafeInPlaceOps<T, InRange<T, n, m>>
         }
         template<T mm>
         std::optional<InRange<T, n, mm>> constrain_lteq() const {
-            if (this->x > n) return std::nullopt;
-            return assume_lteq<n>();
+            if (this->x > mm) return std::nullopt;
+            return assume_lteq<mm>();
         }
 
         template<T nn>
@@ -492,8 +684,8 @@ class InRange<T, n, m> : public N<T>, public SafeInPlaceOps<T, InRange<T, n, m>>
         }
         template<T nn>
         std::optional<InRange<T, nn, m>> constrain_gteq() const {
-            if (this->x < n) return std::nullopt;
-            return assume_gteq<n>();
+            if (this->x < nn) return std::nullopt;
+            return assume_gteq<nn>();
         }
 
         template<signed_int TT, signed_int TTT = T>
@@ -553,36 +745,113 @@ class InRange<T, n, m> : public N<T> {
         
         Self& operator+=(T x) { this->x += x; return *this; }
         Self& operator-=(T x) { this->x -= x; return *this; }
-        Self& operator*=(T x) { this->x += x; return *this; }
-        Self& operator/=(T x) { this->x += x; return *this; }
-        Self& operator<<=(T x) { this->x += x; return *this; }
-        Self& operator>>=(T x) { this->x += x; return *this; }
-        Self& operator|=(T x) { this->x += x; return *this; }
-        Self& operator&=(T x) { this->x += x; return *this; }
+        Self& operator*=(T x) { this->x *= x; return *this; }
+        Self& operator/=(T x) { this->x /= x; return *this; }
+        Self& operator<<=(T x) { this->x <<= x; return *this; }
+        Self& operator>>=(T x) { this->x >>= x; return *this; }
+        Self& operator|=(T x) { this->x |= x; return *this; }
+        Self& operator&=(T x) { this->x &= x; return *this; }
+
+        // the domain as a ring of `size` values, 0 standing for all 2^bits
+        static constexpr T size = static_cast<T>(m - n + 1);
+
+        // bounds of sums and differences that don't wrap, as long as neither operand does
+        template<unsigned_int TT, TT nn, TT mm>
+        static constexpr bool exact_sum = n <= m && nn <= mm
+            && static_cast<unsigned long long>(m) <= std::numeric_limits<unsigned long long>::max() - mm;
+        template<unsigned_int TT, TT nn, TT mm>
+        static constexpr bool exact_difference = n <= m && nn <= mm && static_cast<unsigned long long>(n) >= mm;
+
+        template<unsigned_int TT, TT nn, TT mm>
+        using sum_result = arithmetic_result<T, TT, static_cast<unsigned long long>(n) + nn, static_cast<unsigned long long>(m) + mm, true>;
+        template<unsigned_int TT, TT nn, TT mm>
+        using difference_result = arithmetic_result<T, TT, static_cast<unsigned long long>(n) - mm, static_cast<unsigned long long>(m) - nn, true>;
 
     public:
         constexpr InRange() : N<T>(n) { compiler_hint(); static_assert(std::is_trivially_copyable<Self>()); }
         consteval InRange(T x) : N<T>(x) { compiler_hint(); }
 
-        template<signed_int TT> requires (n <= m)
-        operator InRange<TT, n, m>() const { return InRange<TT, n, m>(*this); }
+        template<signed_int TT> requires (n <= m && std::in_range<TT>(m))
+        operator InRange<TT, n, m>() const { return InRange<TT, n, m>(N<TT>(this->x)); }
 
-        template<unsigned_int TT, TT nn, TT mm> requires ((nn <= mm && nn <= n && mm >= m) ||  (nn > mm)) // todo fix constraint
-        operator InRange<TT, nn, mm>() const { return InRange<TT, nn, mm>(*this); }
+        template<unsigned_int TT, TT nn, TT mm> requires (static_cast<TT>(nn - 1) != mm && !(std::is_same_v<T, TT> && nn == n && mm == m)
+                && unsigned_range_within<T, TT>(n, m, nn, mm))
+        constexpr operator InRange<TT, nn, mm>() const { return InRange<TT, nn, mm>(N<TT>(static_cast<TT>(this->x))); }
 
-        template<unsigned_int TT, TT nn, TT mm>
-        InRange<std::common_type_t<TT, T>, n + nn, m + mm> operator+(InRange<TT, nn, mm> other) const {
-            using CT = std::common_type_t<T, TT>;
-            if constexpr ((mm - nn) + (m - n) < (mm - nn)) return N<CT>(N<T>(this->x + other.x));
-            return InRange<CT, n + nn, m + mm>(N<T>(this->x + other.x));
+        // addition and subtraction modulo 2^bits, with the bounds carried along the ring
+        template<unsigned_int TT, TT nn, TT mm> requires (modular_bounds<T, n, m, TT, nn, mm>::representable)
+        constexpr auto operator+(InRange<TT, nn, mm> other) const {
+            using B = modular_bounds<T, n, m, TT, nn, mm>;
+            using W = typename B::W;
+            using P = typename B::P;
+            return wrap_result<typename B::sum>(static_cast<W>(static_cast<P>(this->x) + static_cast<P>(static_cast<TT>(other))));
         }
 
-        template<unsigned_int TT, TT nn, TT mm>
-        auto operator-(InRange<TT, nn, mm> other) const {
-            return *this + InRange<TT, -mm, -nn>(N<TT>(-other.x));
+        template<unsigned_int TT, TT nn, TT mm> requires (modular_bounds<T, n, m, TT, nn, mm>::representable)
+        constexpr auto operator-(InRange<TT, nn, mm> other) const {
+            using B = modular_bounds<T, n, m, TT, nn, mm>;
+            using W = typename B::W;
+            using P = typename B::P;
+            return wrap_result<typename B::difference>(static_cast<W>(static_cast<P>(this->x) - static_cast<P>(static_cast<TT>(other))));
+        }
+
+        // exact bounds in the narrowest unsigned type that holds them, only for operands that don't wrap (and, for the
+        // difference, where it can't go below 0)
+        template<unsigned_int TT, TT nn, TT mm> requires (exact_sum<TT, nn, mm> && sum_result<TT, nn, mm>::fits)
+        constexpr auto narrowing_add(InRange<TT, nn, mm> other) const {
+            using R = typename sum_result<TT, nn, mm>::type;
+            using P = std::common_type_t<R, T, TT, unsigned>;
+            using Result = InRange<R, static_cast<R>(static_cast<unsigned long long>(n) + nn),
+                                      static_cast<R>(static_cast<unsigned long long>(m) + mm)>;
+            return wrap_result<Result>(
+                static_cast<R>(static_cast<P>(this->x) + static_cast<P>(static_cast<TT>(other))));
+        }
+        template<unsigned_int TT, TT nn, TT mm> requires (exact_difference<TT, nn, mm> && difference_result<TT, nn, mm>::fits)
+        constexpr auto narrowing_sub(InRange<TT, nn, mm> other) const {
+            using R = typename difference_result<TT, nn, mm>::type;
+            using P = std::common_type_t<R, T, TT, unsigned>;
+            using Result = InRange<R, static_cast<R>(static_cast<unsigned long long>(n) - mm),
+                                      static_cast<R>(static_cast<unsigned long long>(m) - nn)>;
+            return wrap_result<Result>(
+                static_cast<R>(static_cast<P>(this->x) - static_cast<P>(static_cast<TT>(other))));
+        }
+
+        // steps around the domain itself, for sequence numbers and ring buffer positions. Domains of a power of two size
+        // take a mask, all others a compare (and a modulo if y isn't known to be smaller than the domain).
+        constexpr Self add_wrapping(T y) const {
+            T offset = static_cast<T>(this->x - n);
+            if constexpr (size == 0 || std::has_single_bit(size)) {
+                offset = reduce_modulo<T, size>(static_cast<T>(offset + y));
+            } else {
+                T step = reduce_modulo<T, size>(y);
+                offset = offset >= static_cast<T>(size - step) ? static_cast<T>(offset - (size - step)) : static_cast<T>(offset + step);
+            }
+            return Self(N<T>(static_cast<T>(n + offset)));
+        }
+        constexpr Self sub_wrapping(T y) const {
+            T offset = static_cast<T>(this->x - n);
+            if constexpr (size == 0 || std::has_single_bit(size)) {
+                offset = reduce_modulo<T, size>(static_cast<T>(offset - y));
+            } else {
+                T step = reduce_modulo<T, size>(y);
+                offset = offset >= step ? static_cast<T>(offset - step) : static_cast<T>(offset + (size - step));
+            }
+            return Self(N<T>(static_cast<T>(n + offset)));
         }
 
         
+        constexpr auto narrow() const requires (n <= m) {
+            using R = narrowest_unsigned_t<m>;
+            return InRange<R, n, m>(N<R>(static_cast<R>(this->x)));
+        }
+        template<unsigned_int TT> requires (sizeof(TT) >= sizeof(T) && n <= m && std::in_range<TT>(m))
+        constexpr InRange<TT, n, m> widen() const { return InRange<TT, n, m>(N<TT>(this->x)); }
+
+        constexpr auto as_signed() const requires (n <= m && std::in_range<std::make_signed_t<T>>(m)) {
+            using R = std::make_signed_t<T>;
+            return InRange<R, n, m>(N<R>(static_cast<R>(this->x)));
+        }
+
         Self& decrement_unsafe(T x) { return (*this)-= x; }
         Self& increment_unsafe(T x) { return (*this)+= x; }
 
@@ -593,7 +862,7 @@ class InRange<T, n, m> : public N<T> {
             } else {
                 if (this->x < nn && this->x > mm) return std::nullopt;
             }
-            return static_cast<N<T>&>(*this).template assume_in_range<nn, mm>();
+            return static_cast<const N<T>&>(*this).template assume_in_range<nn, mm>();
         }
 
         constexpr void compiler_hint() {
@@ -608,6 +877,12 @@ class InRange<T, n, m> : public N<T> {
             }
         }
 
+    private:
+        template<typename R, unsigned_int W>
+        static constexpr R wrap_result(W x) {
+            if constexpr (has_validator<R, W>) return R(N<W>(x));
+            else return R(x);
+        }
 };
 
 
@@ -765,6 +1040,8 @@ class safe_ptr {
         friend class safe_ptr;
         template<typename, size_t>
         friend class safe_array;
+        template<size_t capacity, size_t alignment> requires (capacity > 0 && (alignment & (alignment - 1)) == 0)
+        friend class arena;
 
         using Self = safe_ptr<T, n, m>;
         constexpr safe_ptr(T* pointer) : pointer(pointer) { static_assert(std::is_trivially_copyable<safe_ptr<T, n, m>>()); }
@@ -805,13 +1082,13 @@ class safe_array : public std::array<T, n> {
     public:
         using std::array<T, n>::array;
     private:
-        T& operator[](size_t i) { return (*static_cast<std::array<T, n>*>(this))[i]; }
-        const T& operator[](size_t i) const { return (*static_cast<const std::array<T, n>*>(this))[i]; }
+        constexpr T& operator[](size_t i) { return (*static_cast<std::array<T, n>*>(this))[i]; }
+        constexpr const T& operator[](size_t i) const { return (*static_cast<const std::array<T, n>*>(this))[i]; }
     public:
         template<size_t l, size_t u> requires(l >= 0 && u < n)
-        T& operator[](InRange<size_t, l, u> i) { return (*this)[static_cast<int>(i)]; }
+        constexpr T& operator[](InRange<size_t, l, u> i) { return (*this)[static_cast<int>(i)]; }
         template<size_t l, size_t u> requires(l >= 0 && u < n)
-        const T& operator[](InRange<size_t, l, u> i) const { return (*this)[static_cast<int>(i)]; }
+        constexpr const T& operator[](InRange<size_t, l, u> i) const { return (*this)[static_cast<int>(i)]; }
         template<std::ptrdiff_t l, std::ptrdiff_t u> requires(l >= 0 && u <= n)
         operator safe_ptr<T, l, u>() {
             return safe_ptr<T, l, u>(&this->front());
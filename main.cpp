@@ -2,6 +2,8 @@
 #include <iostream>
 #include <vector>
 #include "int.hpp"
+#include "constexpr_table.hpp"
+#include "simd.hpp"
 
 
 void test1(LessThanEq<int, 2> x) {
@@ -26,7 +28,7 @@ constexpr int _fib(int x) {
 
 template<int n, int m> requires (n >= 0 && m < 46)
 auto fib(InRange<int, n, m> x) {
-    return N<int>(_fib(x)).assume_lteq<_fib(m)>().template assume_gteq<_fib(n)>();
+    return constexpr_table<_fib, InRange<int, 0, 45>>::lookup(x);
 }
 
 
@@ -117,5 +119,10 @@ int main() {
     safe_ptr<int, 0, 10> ptr = arr;
 
     auto ptr2 = ptr + constant<std::ptrdiff_t, 3>;
+
+    safe_array<InRange<int, 0, 10>, 8> lanes_a;
+    safe_array<InRange<int, 0, 10>, 8> lanes_b;
+    safe_array<InRange<int, 3, 10>, 8> lanes_c = elementwise_max(elementwise_min(lanes_a, lanes_b), constant<int, 3>);
+    std::cout << lanes_c[constant<size_t, 0>] << std::endl;
     
 }
\ No newline at end of file
@@ -0,0 +1,205 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include "int.hpp"
+#include "serialize.hpp"
+
+
+template<size_t len>
+struct fixed_string {
+    char chars[len];
+
+    constexpr fixed_string(const char (&s)[len]) { std::copy_n(s, len, chars); }
+
+    template<size_t other>
+    constexpr bool operator==(const fixed_string<other>& s) const {
+        if constexpr (len != other) return false;
+        else return std::equal(chars, chars + len, s.chars);
+    }
+};
+
+// a named member of a packed_struct, it takes bit_codec<T>::bits bits (the offset from the lower bound)
+template<fixed_string field_name, typename T>
+    requires requires (uint64_t b) { bit_codec<T>::from_bits(b); }
+struct Field {
+    static constexpr auto name = field_name;
+    using type = T;
+    static constexpr unsigned bits = bit_codec<T>::bits;
+};
+
+namespace detail {
+
+    template<fixed_string name, typename... Fields>
+    constexpr size_t field_index() {
+        constexpr bool matches[] = { (Fields::name == name)... };
+        return std::find(std::begin(matches), std::end(matches), true) - std::begin(matches);
+    }
+
+    template<typename... Fields>
+    constexpr bool unique_names() {
+        constexpr size_t indices[] = { field_index<Fields::name, Fields...>()... };
+        for (size_t i = 0; i < sizeof...(Fields); i++) {
+            if (indices[i] != i) return false;
+        }
+        return true;
+    }
+
+    struct packed_slot {
+        size_t word;
+        unsigned shift;
+    };
+
+    // fields go into 64 bit words in declaration order, a field that doesn't fit the rest of a word starts the next
+    // one, so no field ever straddles two words. A layout that needs a single word stores it in the narrowest type.
+    template<unsigned... bits>
+    struct packed_layout {
+        static constexpr std::array<packed_slot, sizeof...(bits)> slots = [] {
+            std::array<packed_slot, sizeof...(bits)> result{};
+            size_t word = 0;
+            unsigned used = 0;
+            size_t i = 0;
+            for (unsigned b : { bits... }) {
+                if (used + b > 64) {
+                    word++;
+                    used = 0;
+                }
+                result[i++] = { word, used };
+                used += b;
+            }
+            return result;
+        }();
+
+        static constexpr size_t words = sizeof...(bits) == 0 ? 1 : slots.back().word + 1;
+        static constexpr unsigned used_bits = words > 1 ? 64 : (bits + ... + 0);
+
+        using word_type = narrowest_unsigned_t<used_bits >= 64 ? ~0ULL : (1ULL << used_bits) - 1>;
+    };
+
+    template<typename W, unsigned bits>
+    inline constexpr W low_mask = bits >= sizeof(W) * 8 ? static_cast<W>(~W(0)) : static_cast<W>((W(1) << bits) - 1);
+
+    template<typename T>
+    constexpr auto narrowed(T x) {
+        if constexpr (requires { x.narrow(); }) return x.narrow();
+        else return x;
+    }
+
+    template<typename T>
+    using column_type = decltype(narrowed(std::declval<T>()));
+}
+
+
+// several constrained values bit packed into as few words as their domains allow:
+//   packed_struct<Field<"kind", InRange<int, 0, 7>>, Field<"size", InRange<int, 0, 1023>>, Field<"dirty", bool>>
+// takes 14 bits and is a single uint16_t. get<"kind">() hands back an InRange<int, 0, 7> that carries its bounds as
+// compiler hints, set<"kind">(x) is a shift and insert, as x is known to fit its bits already.
+template<typename... Fields>
+    requires (sizeof...(Fields) > 0 && detail::unique_names<Fields...>())
+class packed_struct {
+    private:
+        using layout = detail::packed_layout<Fields::bits...>;
+        using W = typename layout::word_type;
+
+        template<fixed_string name>
+        static constexpr size_t index = detail::field_index<name, Fields...>();
+
+        template<size_t i>
+        using field_at = std::tuple_element_t<i, std::tuple<Fields...>>;
+
+    public:
+        template<fixed_string name> requires (index<name> < sizeof...(Fields))
+        using type_of = typename field_at<index<name>>::type;
+
+        static constexpr unsigned bits = (Fields::bits + ... + 0);
+
+        // every field at its lower bound (false for flags)
+        constexpr packed_struct() : words{} {}
+        constexpr packed_struct(typename Fields::type... xs) : words{} {
+            [&]<size_t... i>(std::index_sequence<i...>) {
+                (put<i>(xs), ...);
+            }(std::index_sequence_for<Fields...>{});
+        }
+
+        template<fixed_string name> requires (index<name> < sizeof...(Fields))
+        constexpr type_of<name> get() const {
+            return take<index<name>>();
+        }
+
+        template<fixed_string name> requires (index<name> < sizeof...(Fields))
+        constexpr void set(type_of<name> x) {
+            put<index<name>>(x);
+        }
+
+        constexpr bool operator==(const packed_struct&) const = default;
+
+    private:
+        template<size_t i>
+        constexpr typename field_at<i>::type take() const {
+            using F = field_at<i>;
+            constexpr detail::packed_slot slot = layout::slots[i];
+            W raw = static_cast<W>(words[slot.word] >> slot.shift) & detail::low_mask<W, F::bits>;
+            return bit_codec<typename F::type>::from_bits(raw);
+        }
+
+        template<size_t i>
+        constexpr void put(typename field_at<i>::type x) {
+            using F = field_at<i>;
+            constexpr detail::packed_slot slot = layout::slots[i];
+            if constexpr (F::bits > 0) {
+                constexpr W clear = static_cast<W>(~static_cast<W>(detail::low_mask<W, F::bits> << slot.shift));
+                W raw = static_cast<W>(bit_codec<typename F::type>::to_bits(x));
+                words[slot.word] = static_cast<W>((words[slot.word] & clear) | static_cast<W>(raw << slot.shift));
+            }
+        }
+
+        std::array<W, layout::words> words;
+};
+
+
+// struct of arrays counterpart of safe_array<packed_struct<Fields...>, capacity>: every field gets its own column in
+// the narrowest type for its domain, so a scan over one field touches nothing else and can go through simd.hpp or
+// reduce.hpp directly
+template<size_t capacity, typename... Fields>
+    requires (capacity > 0 && sizeof...(Fields) > 0 && detail::unique_names<Fields...>())
+class packed_columns {
+    private:
+        template<fixed_string name>
+        static constexpr size_t index = detail::field_index<name, Fields...>();
+
+    public:
+        using record = packed_struct<Fields...>;
+        using index_type = InRange<size_t, 0, capacity - 1>;
+
+        template<fixed_string name> requires (index<name> < sizeof...(Fields))
+        using type_of = typename record::template type_of<name>;
+
+        template<fixed_string name> requires (index<name> < sizeof...(Fields))
+        constexpr auto& column() { return std::get<index<name>>(columns); }
+        template<fixed_string name> requires (index<name> < sizeof...(Fields))
+        constexpr const auto& column() const { return std::get<index<name>>(columns); }
+
+        template<fixed_string name> requires (index<name> < sizeof...(Fields))
+        constexpr type_of<name> get(index_type i) const {
+            return static_cast<type_of<name>>(column<name>()[i]);
+        }
+        template<fixed_string name> requires (index<name> < sizeof...(Fields))
+        constexpr void set(index_type i, type_of<name> x) {
+            column<name>()[i] = detail::narrowed(x);
+        }
+
+        constexpr record load(index_type i) const {
+            return record(get<Fields::name>(i)...);
+        }
+        constexpr void store(index_type i, const record& r) {
+            (set<Fields::name>(i, r.template get<Fields::name>()), ...);
+        }
+
+        static constexpr size_t size() { return capacity; }
+
+    private:
+        std::tuple<safe_array<detail::column_type<typename Fields::type>, capacity>...> columns;
+};
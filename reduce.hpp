@@ -0,0 +1,212 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include "int.hpp"
+#include "simd.hpp"
+
+
+namespace detail {
+
+    template<typename>
+    struct reduce_bounds;
+
+    template<signed_int T, T n, T m>
+    struct reduce_bounds<InRange<T, n, m>> {
+        using type = T;
+        static constexpr long long lo = n;
+        static constexpr long long hi = m;
+    };
+
+    template<typename E>
+    using reduce_type = typename reduce_bounds<std::remove_const_t<E>>::type;
+
+    // how many terms from [lo, hi] can be added up in I without any partial sum overflowing it
+    template<typename I, long long lo, long long hi>
+    constexpr size_t terms_fitting() {
+        size_t k = std::numeric_limits<size_t>::max();
+        if (hi > 0) k = std::min(k, static_cast<size_t>(std::numeric_limits<I>::max() / hi));
+        if (lo < 0) k = std::min(k, static_cast<size_t>(std::numeric_limits<I>::min() / lo));
+        return k;
+    }
+
+    template<typename I>
+    using wider_t = std::conditional_t<sizeof(I) == 1, int16_t, std::conditional_t<sizeof(I) == 2, int32_t, int64_t>>;
+
+    // whether len * lo and len * hi (and with them every partial sum) fit long long, the widest accumulator there is
+    template<long long lo, long long hi, size_t len>
+    constexpr bool reduction_fits() {
+        if (!std::in_range<long long>(len)) return false;
+        return !mul_overflows(static_cast<long long>(len), lo) && !mul_overflows(static_cast<long long>(len), hi);
+    }
+
+    // sums of len terms from [lo, hi] end up in Acc, the narrowest type that holds [len * lo, len * hi]. Blocks of up to
+    // `block` terms are first added up in the narrower Inner (which gets more SIMD lanes) and then widened into Acc.
+    template<long long lo, long long hi, size_t len> requires (reduction_fits<lo, hi, len>())
+    struct reduction_plan {
+        static constexpr long long sum_lo = static_cast<long long>(len) * lo;
+        static constexpr long long sum_hi = static_cast<long long>(len) * hi;
+        using Acc = narrowest_signed_t<std::min(0LL, sum_lo), std::max(0LL, sum_hi)>;
+
+        static constexpr size_t min_block = 64;
+
+        template<typename I>
+        static auto pick_inner() {
+            if constexpr (sizeof(I) >= sizeof(Acc)) return Acc{};
+            else if constexpr (terms_fitting<I, lo, hi>() >= min_block) return I{};
+            else return pick_inner<wider_t<I>>();
+        }
+        using Inner = decltype(pick_inner<narrowest_signed_t<lo, hi>>());
+
+        static constexpr size_t block = std::is_same_v<Inner, Acc>
+            ? std::max<size_t>(len, 1)
+            : terms_fitting<Inner, lo, hi>() / min_block * min_block;
+    };
+
+    template<typename V, size_t lanes, typename T>
+    [[gnu::always_inline]] inline void load_widened(V& v, const T* p) {
+        vec<T, lanes * sizeof(T)> raw;
+        __builtin_memcpy(&raw, p, sizeof(raw));
+        v = __builtin_convertvector(raw, V);
+    }
+
+    // with B = void a sum over a, otherwise the dot product of a and b
+    template<typename Inner, typename Acc, size_t block, typename A, typename B>
+    struct reduce_kernel {
+        static Inner term(const A* a, const B* b, size_t i) {
+            if constexpr (std::is_void_v<B>) return static_cast<Inner>(a[i]);
+            else return static_cast<Inner>(static_cast<Inner>(a[i]) * static_cast<Inner>(b[i]));
+        }
+
+        template<size_t W>
+        [[gnu::always_inline]] static Acc run(const A* a, const B* b, size_t count) {
+            Acc total = 0;
+            size_t i = 0;
+            while (i < count) {
+                size_t end = std::min(count, i + block);
+                Inner partial = 0;
+                if constexpr (W > 0) {
+                    using V = vec<Inner, W>;
+                    constexpr size_t lanes = W / sizeof(Inner);
+                    V acc = {};
+                    for (; i + lanes <= end; i += lanes) {
+                        V x;
+                        load_widened<V, lanes>(x, a + i);
+                        if constexpr (!std::is_void_v<B>) {
+                            V y;
+                            load_widened<V, lanes>(y, b + i);
+                            x *= y;
+                        }
+                        acc += x;
+                    }
+                    for (size_t l = 0; l < lanes; l++) partial += acc[l];
+                }
+                for (; i < end; i++) partial += term(a, b, i);
+                total += partial;
+            }
+            return total;
+        }
+    };
+
+    template<typename E, std::ptrdiff_t n, std::ptrdiff_t m>
+    const reduce_type<E>* reduce_lanes(safe_ptr<E, n, m> p) {
+        static_assert(is_lane_compatible<std::remove_const_t<E>, reduce_type<E>>);
+        if constexpr (n == m) return nullptr;
+        else return reinterpret_cast<const reduce_type<E>*>(&p[::constant<std::ptrdiff_t, n>]);
+    }
+
+    template<long long lo, long long hi, size_t len, typename A, typename B>
+    auto reduce(const A* a, const B* b) {
+        using plan = reduction_plan<lo, hi, len>;
+        using Acc = typename plan::Acc;
+        Acc total = simd_dispatch<reduce_kernel<typename plan::Inner, Acc, plan::block, A, B>>(a, b, len);
+        return N<Acc>(total).template assume<InRange<Acc, static_cast<Acc>(plan::sum_lo), static_cast<Acc>(plan::sum_hi)>>();
+    }
+
+    // with fits false the products don't fit long long and min/max are meaningless
+    template<long long lo, long long hi, long long llo, long long hhi>
+    struct product_bounds {
+        static constexpr bool fits = !mul_overflows(lo, llo) && !mul_overflows(lo, hhi) && !mul_overflows(hi, llo) && !mul_overflows(hi, hhi);
+        static constexpr long long corners[] = { fits ? lo * llo : 0, fits ? lo * hhi : 0, fits ? hi * llo : 0, fits ? hi * hhi : 0 };
+        static constexpr long long min = std::min({ corners[0], corners[1], corners[2], corners[3] });
+        static constexpr long long max = std::max({ corners[0], corners[1], corners[2], corners[3] });
+    };
+
+    template<typename E, typename EE, size_t len>
+    constexpr bool dot_fits() {
+        using B = reduce_bounds<std::remove_const_t<E>>;
+        using BB = reduce_bounds<std::remove_const_t<EE>>;
+        using P = product_bounds<B::lo, B::hi, BB::lo, BB::hi>;
+        if constexpr (!P::fits) return false;
+        else return reduction_fits<P::min, P::max, len>();
+    }
+
+    template<typename E, size_t len>
+    constexpr bool element_sum_fits() {
+        using B = reduce_bounds<std::remove_const_t<E>>;
+        return reduction_fits<B::lo, B::hi, len>();
+    }
+}
+
+
+// sum of all elements, typed with exactly the bounds len * [lo, hi] in the narrowest type that holds them. Only
+// offered while those bounds fit int64_t.
+
+template<typename E, std::ptrdiff_t n, std::ptrdiff_t m> requires (n <= m && detail::element_sum_fits<E, static_cast<size_t>(m - n)>())
+auto sum(safe_ptr<E, n, m> p) {
+    using B = detail::reduce_bounds<std::remove_const_t<E>>;
+    return detail::reduce<B::lo, B::hi, static_cast<size_t>(m - n)>(detail::reduce_lanes(p), static_cast<const void*>(nullptr));
+}
+
+template<typename E, size_t len> requires (detail::element_sum_fits<E, len>())
+auto sum(const safe_array<E, len>& arr) {
+    return sum(static_cast<safe_ptr<const E, 0, len>>(arr));
+}
+
+
+// dot product, the term bounds are the extremes of the products of the element bounds
+
+template<typename E, std::ptrdiff_t n, std::ptrdiff_t m, typename EE, std::ptrdiff_t nn, std::ptrdiff_t mm>
+    requires (n <= m && m - n == mm - nn && detail::dot_fits<E, EE, static_cast<size_t>(m - n)>())
+auto dot(safe_ptr<E, n, m> p, safe_ptr<EE, nn, mm> q) {
+    using B = detail::reduce_bounds<std::remove_const_t<E>>;
+    using BB = detail::reduce_bounds<std::remove_const_t<EE>>;
+    using P = detail::product_bounds<B::lo, B::hi, BB::lo, BB::hi>;
+    return detail::reduce<P::min, P::max, static_cast<size_t>(m - n)>(detail::reduce_lanes(p), detail::reduce_lanes(q));
+}
+
+template<typename E, typename EE, size_t len> requires (detail::dot_fits<E, EE, len>())
+auto dot(const safe_array<E, len>& a, const safe_array<EE, len>& b) {
+    return dot(static_cast<safe_ptr<const E, 0, len>>(a), static_cast<safe_ptr<const EE, 0, len>>(b));
+}
+
+
+// running sums, every element is typed with the bounds that hold for all prefixes
+
+template<typename E, std::ptrdiff_t n, std::ptrdiff_t m> requires (n <= m && detail::element_sum_fits<E, static_cast<size_t>(m - n)>())
+auto prefix_sum(safe_ptr<E, n, m> p) {
+    constexpr size_t len = static_cast<size_t>(m - n);
+    using B = detail::reduce_bounds<std::remove_const_t<E>>;
+    using plan = detail::reduction_plan<B::lo, B::hi, len>;
+    using Acc = typename plan::Acc;
+    using R = InRange<Acc, static_cast<Acc>(std::min(B::lo, plan::sum_lo)), static_cast<Acc>(std::max(B::hi, plan::sum_hi))>;
+    static_assert(detail::is_lane_compatible<R, Acc>);
+
+    const detail::reduce_type<E>* a = detail::reduce_lanes(p);
+    std::array<Acc, len> raw;
+    Acc running = 0;
+    for (size_t i = 0; i < len; i++) {
+        running += a[i];
+        raw[i] = running;
+    }
+    return std::bit_cast<safe_array<R, len>>(raw);
+}
+
+template<typename E, size_t len> requires (detail::element_sum_fits<E, len>())
+auto prefix_sum(const safe_array<E, len>& arr) {
+    return prefix_sum(static_cast<safe_ptr<const E, 0, len>>(arr));
+}
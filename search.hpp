@@ -0,0 +1,143 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include "int.hpp"
+
+
+namespace detail {
+
+    // one halving step per level, fully unrolled for a compile time length. Each step is a conditional move instead
+    // of a branch, so the search costs the same ~log2(len) loads whatever the data.
+    template<size_t len, typename E, typename Pred>
+    inline void narrow(const E*& base, Pred& pred) {
+        if constexpr (len > 1) {
+            constexpr size_t half = len / 2;
+            base = pred(base[half]) ? base + half : base;
+            narrow<len - half>(base, pred);
+        }
+    }
+
+    // number of leading elements for which pred holds, pred has to be true for a prefix and false for the rest
+    template<size_t len, typename E, typename Pred>
+    inline size_t partition_point(const E* first, Pred pred) {
+        if constexpr (len == 0) {
+            return 0;
+        } else {
+            const E* base = first;
+            narrow<len>(base, pred);
+            return static_cast<size_t>(base - first) + (pred(*base) ? 1 : 0);
+        }
+    }
+
+    template<size_t len, typename E, typename Pred>
+    inline std::optional<size_t> find_if(const E* first, Pred pred) {
+        for (size_t i = 0; i < len; i++) {
+            if (pred(first[i])) return i;
+        }
+        return std::nullopt;
+    }
+
+    template<size_t len, typename E, typename Compare>
+    inline size_t min_element(const E* first, Compare comp) {
+        size_t best = 0;
+        for (size_t i = 1; i < len; i++) {
+            best = comp(first[i], first[best]) ? i : best;
+        }
+        return best;
+    }
+
+    template<size_t len>
+    InRange<size_t, 0, len> insertion_point(size_t i) {
+        return N<size_t>(i).template assume_in_range<0, len>();
+    }
+
+    template<size_t len> requires (len > 0)
+    InRange<size_t, 0, len - 1> element_index(size_t i) {
+        return N<size_t>(i).template assume_in_range<0, len - 1>();
+    }
+
+    template<std::ptrdiff_t n, std::ptrdiff_t m>
+    InRange<std::ptrdiff_t, n, m> ptr_index(size_t i) {
+        return N<std::ptrdiff_t>(n + static_cast<std::ptrdiff_t>(i)).template assume<InRange<std::ptrdiff_t, n, m>>();
+    }
+
+    template<typename T, std::ptrdiff_t n, std::ptrdiff_t m> requires (n < m)
+    const T* ptr_first(safe_ptr<T, n, m> p) {
+        return &p[::constant<std::ptrdiff_t, n>];
+    }
+}
+
+
+// safe_array: element indices are InRange<size_t, 0, len - 1>, insertion points InRange<size_t, 0, len>
+
+template<typename T, size_t len, typename V, typename Compare = std::less<>>
+InRange<size_t, 0, len> lower_bound(const safe_array<T, len>& arr, const V& value, Compare comp = {}) {
+    return detail::insertion_point<len>(detail::partition_point<len>(arr.data(), [&](const T& e) { return comp(e, value); }));
+}
+
+template<typename T, size_t len, typename V, typename Compare = std::less<>>
+InRange<size_t, 0, len> upper_bound(const safe_array<T, len>& arr, const V& value, Compare comp = {}) {
+    return detail::insertion_point<len>(detail::partition_point<len>(arr.data(), [&](const T& e) { return !comp(value, e); }));
+}
+
+template<typename T, size_t len, typename Pred>
+InRange<size_t, 0, len> partition_point(const safe_array<T, len>& arr, Pred pred) {
+    return detail::insertion_point<len>(detail::partition_point<len>(arr.data(), pred));
+}
+
+template<typename T, size_t len, typename V> requires (len > 0)
+std::optional<InRange<size_t, 0, len - 1>> find(const safe_array<T, len>& arr, const V& value) {
+    auto i = detail::find_if<len>(arr.data(), [&](const T& e) { return e == value; });
+    if (!i) return std::nullopt;
+    return detail::element_index<len>(*i);
+}
+
+template<typename T, size_t len, typename Pred> requires (len > 0)
+std::optional<InRange<size_t, 0, len - 1>> find_if(const safe_array<T, len>& arr, Pred pred) {
+    auto i = detail::find_if<len>(arr.data(), pred);
+    if (!i) return std::nullopt;
+    return detail::element_index<len>(*i);
+}
+
+template<typename T, size_t len, typename Compare = std::less<>> requires (len > 0)
+InRange<size_t, 0, len - 1> min_element(const safe_array<T, len>& arr, Compare comp = {}) {
+    return detail::element_index<len>(detail::min_element<len>(arr.data(), comp));
+}
+
+
+// safe_ptr<T, n, m>: element indices are InRange<std::ptrdiff_t, n, m - 1>, insertion points InRange<std::ptrdiff_t, n, m>
+
+template<typename T, std::ptrdiff_t n, std::ptrdiff_t m, typename V, typename Compare = std::less<>> requires (n < m)
+InRange<std::ptrdiff_t, n, m> lower_bound(safe_ptr<T, n, m> p, const V& value, Compare comp = {}) {
+    return detail::ptr_index<n, m>(detail::partition_point<m - n>(detail::ptr_first(p), [&](const T& e) { return comp(e, value); }));
+}
+
+template<typename T, std::ptrdiff_t n, std::ptrdiff_t m, typename V, typename Compare = std::less<>> requires (n < m)
+InRange<std::ptrdiff_t, n, m> upper_bound(safe_ptr<T, n, m> p, const V& value, Compare comp = {}) {
+    return detail::ptr_index<n, m>(detail::partition_point<m - n>(detail::ptr_first(p), [&](const T& e) { return !comp(value, e); }));
+}
+
+template<typename T, std::ptrdiff_t n, std::ptrdiff_t m, typename Pred> requires (n < m)
+InRange<std::ptrdiff_t, n, m> partition_point(safe_ptr<T, n, m> p, Pred pred) {
+    return detail::ptr_index<n, m>(detail::partition_point<m - n>(detail::ptr_first(p), pred));
+}
+
+template<typename T, std::ptrdiff_t n, std::ptrdiff_t m, typename V> requires (n < m)
+std::optional<InRange<std::ptrdiff_t, n, m - 1>> find(safe_ptr<T, n, m> p, const V& value) {
+    auto i = detail::find_if<m - n>(detail::ptr_first(p), [&](const T& e) { return e == value; });
+    if (!i) return std::nullopt;
+    return detail::ptr_index<n, m - 1>(*i);
+}
+
+template<typename T, std::ptrdiff_t n, std::ptrdiff_t m, typename Pred> requires (n < m)
+std::optional<InRange<std::ptrdiff_t, n, m - 1>> find_if(safe_ptr<T, n, m> p, Pred pred) {
+    auto i = detail::find_if<m - n>(detail::ptr_first(p), pred);
+    if (!i) return std::nullopt;
+    return detail::ptr_index<n, m - 1>(*i);
+}
+
+template<typename T, std::ptrdiff_t n, std::ptrdiff_t m, typename Compare = std::less<>> requires (n < m)
+InRange<std::ptrdiff_t, n, m - 1> min_element(safe_ptr<T, n, m> p, Compare comp = {}) {
+    return detail::ptr_index<n, m - 1>(detail::min_element<m - n>(detail::ptr_first(p), comp));
+}
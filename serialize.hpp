@@ -0,0 +1,249 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include "int.hpp"
+
+
+// LSB first bit stream into a caller provided buffer
+class bit_writer {
+    public:
+        bit_writer(std::byte* buffer, size_t size) : buffer(buffer), size(size), position(0), pending(0), pending_bits(0) {}
+
+        // writes the low `bits` bits of v, or nothing at all if they don't fit anymore
+        bool write(uint64_t v, unsigned bits) {
+            if (bits > remaining_bits()) return false;
+            while (bits > 0) {
+                unsigned take = std::min(bits, 56u);
+                pending |= (v & ((uint64_t(1) << take) - 1)) << pending_bits;
+                pending_bits += take;
+                v >>= take;
+                bits -= take;
+                while (pending_bits >= 8) {
+                    buffer[position++] = static_cast<std::byte>(pending);
+                    pending >>= 8;
+                    pending_bits -= 8;
+                }
+            }
+            return true;
+        }
+
+        // writes out a trailing partial byte and returns the number of bytes used
+        size_t finish() {
+            if (pending_bits > 0) {
+                buffer[position++] = static_cast<std::byte>(pending);
+                pending = 0;
+                pending_bits = 0;
+            }
+            return position;
+        }
+
+        size_t remaining_bits() const { return (size - position) * 8 - pending_bits; }
+
+    private:
+        std::byte* buffer;
+        size_t size;
+        size_t position;
+        uint64_t pending;
+        unsigned pending_bits;
+};
+
+class bit_reader {
+    public:
+        bit_reader(const std::byte* buffer, size_t size) : buffer(buffer), size(size), position(0), pending(0), pending_bits(0), overrun(false) {}
+
+        // reads `bits` bits, past the end of the buffer it reads zeros and remembers that it did
+        uint64_t read(unsigned bits) {
+            if (bits > remaining_bits()) {
+                overrun = true;
+                return 0;
+            }
+            uint64_t result = 0;
+            unsigned shift = 0;
+            while (bits > 0) {
+                while (pending_bits < 56 && position < size) {
+                    pending |= static_cast<uint64_t>(buffer[position++]) << pending_bits;
+                    pending_bits += 8;
+                }
+                unsigned take = std::min(bits, pending_bits);
+                result |= (pending & ((uint64_t(1) << take) - 1)) << shift;
+                pending >>= take;
+                pending_bits -= take;
+                shift += take;
+                bits -= take;
+            }
+            return result;
+        }
+
+        size_t remaining_bits() const { return (size - position) * 8 + pending_bits; }
+        bool exhausted() const { return overrun; }
+
+    private:
+        const std::byte* buffer;
+        size_t size;
+        size_t position;
+        uint64_t pending;
+        unsigned pending_bits;
+        bool overrun;
+};
+
+
+// bit_codec<T> knows how many bits T needs and how to move it through a bit stream. Values are stored as their offset
+// from the lower bound, so InRange<int, 0, 1000> takes 10 bits and InRange<int, 1000, 1003> takes 2.
+// Structs take part by listing their constrained members: static constexpr auto fields = std::make_tuple(&S::a, &S::b);
+template<typename T>
+struct bit_codec;
+
+template<std::integral T, T n, T m>
+struct bit_codec<InRange<T, n, m>> {
+    private:
+        using U = std::make_unsigned_t<T>;
+        using Self = InRange<T, n, m>;
+        static constexpr U span = static_cast<U>(static_cast<U>(m) - static_cast<U>(n));
+    public:
+        static constexpr unsigned bits = std::bit_width(span);
+
+        static constexpr uint64_t to_bits(Self x) {
+            return static_cast<U>(static_cast<U>(static_cast<T>(x)) - static_cast<U>(n));
+        }
+        static constexpr bool valid_bits(uint64_t offset) { return offset <= span; }
+        static constexpr Self from_bits(uint64_t offset) {
+            T x = static_cast<T>(static_cast<U>(static_cast<U>(n) + static_cast<U>(offset)));
+            if constexpr (has_validator<Self, T>) {
+                return N<T>(x).template assume<Self>();
+            } else {
+                return Self(x);
+            }
+        }
+
+        static bool encode(bit_writer& w, Self x) {
+            return w.write(to_bits(x), bits);
+        }
+
+        template<bool validate>
+        static std::optional<Self> decode(bit_reader& r) {
+            uint64_t offset = r.read(bits);
+            if constexpr (validate) {
+                if (r.exhausted() || !valid_bits(offset)) return std::nullopt;
+            }
+            return from_bits(offset);
+        }
+};
+
+template<>
+struct bit_codec<bool> {
+    static constexpr unsigned bits = 1;
+
+    static constexpr uint64_t to_bits(bool x) { return x; }
+    static constexpr bool valid_bits(uint64_t) { return true; }
+    static constexpr bool from_bits(uint64_t x) { return x; }
+
+    static bool encode(bit_writer& w, bool x) { return w.write(x, 1); }
+
+    template<bool validate>
+    static std::optional<bool> decode(bit_reader& r) {
+        bool x = r.read(1);
+        if constexpr (validate) {
+            if (r.exhausted()) return std::nullopt;
+        }
+        return x;
+    }
+};
+
+template<typename T, size_t len>
+struct bit_codec<safe_array<T, len>> {
+    static constexpr unsigned bits = len * bit_codec<T>::bits;
+
+    static bool encode(bit_writer& w, const safe_array<T, len>& xs) {
+        if (w.remaining_bits() < bits) return false;
+        for (const T& x : xs) bit_codec<T>::encode(w, x);
+        return true;
+    }
+
+    template<bool validate>
+    static std::optional<safe_array<T, len>> decode(bit_reader& r) {
+        safe_array<T, len> xs;
+        for (T& x : xs) {
+            auto v = bit_codec<T>::template decode<validate>(r);
+            if constexpr (validate) {
+                if (!v) return std::nullopt;
+            }
+            x = *v;
+        }
+        return xs;
+    }
+};
+
+namespace detail {
+    template<typename S, typename Member>
+    struct member_type;
+
+    template<typename S, typename M>
+    struct member_type<S, M S::*> {
+        using type = M;
+    };
+
+    template<typename S, size_t i>
+    using field_type = typename member_type<S, std::tuple_element_t<i, std::remove_const_t<decltype(S::fields)>>>::type;
+}
+
+template<typename S> requires requires { std::tuple_size<std::remove_const_t<decltype(S::fields)>>::value; }
+struct bit_codec<S> {
+    private:
+        static constexpr size_t field_count = std::tuple_size_v<std::remove_const_t<decltype(S::fields)>>;
+
+        template<size_t... i>
+        static constexpr unsigned sum_bits(std::index_sequence<i...>) {
+            return (bit_codec<detail::field_type<S, i>>::bits + ... + 0);
+        }
+    public:
+        static constexpr unsigned bits = sum_bits(std::make_index_sequence<field_count>{});
+
+        static bool encode(bit_writer& w, const S& s) {
+            if (w.remaining_bits() < bits) return false;
+            std::apply([&](auto... field) { (bit_codec<std::remove_cvref_t<decltype(s.*field)>>::encode(w, s.*field), ...); }, S::fields);
+            return true;
+        }
+
+        template<bool validate>
+        static std::optional<S> decode(bit_reader& r) {
+            S s;
+            bool ok = std::apply([&](auto... field) {
+                return ([&] {
+                    auto v = bit_codec<std::remove_cvref_t<decltype(s.*field)>>::template decode<validate>(r);
+                    if constexpr (validate) {
+                        if (!v) return false;
+                    }
+                    s.*field = *v;
+                    return true;
+                }() && ...);
+            }, S::fields);
+            if (!ok) return std::nullopt;
+            return s;
+        }
+};
+
+
+template<typename T>
+inline constexpr unsigned encoded_bits = bit_codec<T>::bits;
+
+template<typename T>
+bool encode(bit_writer& w, const T& x) {
+    return bit_codec<T>::encode(w, x);
+}
+
+// for trusted frames: values come back typed as they were written, without checking them again
+template<typename T>
+T decode(bit_reader& r) {
+    return *bit_codec<T>::template decode<false>(r);
+}
+
+// for untrusted input: nothing if the buffer runs out or a value lies outside its type's domain
+template<typename T>
+std::optional<T> decode_checked(bit_reader& r) {
+    return bit_codec<T>::template decode<true>(r);
+}
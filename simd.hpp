@@ -0,0 +1,269 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include "int.hpp"
+
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define TYPE_CONSTRAINTS_SIMD_DISPATCH 1
+#else
+#define TYPE_CONSTRAINTS_SIMD_DISPATCH 0
+#endif
+
+
+// all-ones lanes where a comparison holds, zero lanes where it doesn't (the same shape a SIMD compare produces)
+template<signed_int T>
+using lane_mask = InRange<T, -1, 0>;
+
+enum class simd_level { scalar, sse42, avx2, avx512 };
+
+inline simd_level detected_simd_level() {
+#if TYPE_CONSTRAINTS_SIMD_DISPATCH
+    static const simd_level level = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512dq"))
+            return simd_level::avx512;
+        if (__builtin_cpu_supports("avx2"))
+            return simd_level::avx2;
+        if (__builtin_cpu_supports("sse4.2"))
+            return simd_level::sse42;
+        return simd_level::scalar;
+    }();
+    return level;
+#else
+    return simd_level::scalar;
+#endif
+}
+
+namespace detail {
+
+    // the kernels read constrained elements through a T*, which is only sound if InRange<T, ...> is laid out as a bare T
+    template<typename U, typename T>
+    constexpr bool is_lane_compatible = std::is_standard_layout_v<U> && std::is_trivially_copyable_v<U> && sizeof(U) == sizeof(T);
+
+    template<typename T, size_t W>
+    using vec [[gnu::vector_size(W)]] = T;
+
+    template<typename T>
+    struct span_operand {
+        const T* p;
+        T at(size_t i) const { return p[i]; }
+        template<typename V>
+        [[gnu::always_inline]] void load(size_t i, V& v) const { __builtin_memcpy(&v, p + i, sizeof(V)); }
+    };
+
+    template<typename T>
+    struct broadcast_operand {
+        T s;
+        T at(size_t) const { return s; }
+        template<typename V>
+        [[gnu::always_inline]] void load(size_t, V& v) const { v = s - V{}; }
+    };
+
+    struct op_add {
+        template<typename V>
+        [[gnu::always_inline]] static void apply(V& r, const V& a, const V& b) { r = a + b; }
+    };
+    struct op_sub {
+        template<typename V>
+        [[gnu::always_inline]] static void apply(V& r, const V& a, const V& b) { r = a - b; }
+    };
+    struct op_min {
+        template<typename V>
+        [[gnu::always_inline]] static void apply(V& r, const V& a, const V& b) { r = a < b ? a : b; }
+    };
+    struct op_max {
+        template<typename V>
+        [[gnu::always_inline]] static void apply(V& r, const V& a, const V& b) { r = a > b ? a : b; }
+    };
+    struct op_lt {
+        template<typename V>
+        [[gnu::always_inline]] static void apply(V& r, const V& a, const V& b) {
+            if constexpr (std::is_integral_v<V>) r = a < b ? V(-1) : V(0);
+            else r = (V)(a < b);
+        }
+    };
+    struct op_gt {
+        template<typename V>
+        [[gnu::always_inline]] static void apply(V& r, const V& a, const V& b) {
+            if constexpr (std::is_integral_v<V>) r = a > b ? V(-1) : V(0);
+            else r = (V)(a > b);
+        }
+    };
+    struct op_eq {
+        template<typename V>
+        [[gnu::always_inline]] static void apply(V& r, const V& a, const V& b) {
+            if constexpr (std::is_integral_v<V>) r = a == b ? V(-1) : V(0);
+            else r = (V)(a == b);
+        }
+    };
+
+    // Kernel::run<W> is instantiated once per instruction set with W the vector width in bytes (0 for plain scalar
+    // code) and has to be always_inline so that it is compiled for the target of the wrapper it ends up in
+#if TYPE_CONSTRAINTS_SIMD_DISPATCH
+    template<typename Kernel, typename... Args>
+    [[gnu::target("avx512f,avx512bw,avx512dq")]] auto simd_run_avx512(Args... args) {
+        return Kernel::template run<64>(args...);
+    }
+    template<typename Kernel, typename... Args>
+    [[gnu::target("avx2")]] auto simd_run_avx2(Args... args) {
+        return Kernel::template run<32>(args...);
+    }
+    template<typename Kernel, typename... Args>
+    [[gnu::target("sse4.2")]] auto simd_run_sse42(Args... args) {
+        return Kernel::template run<16>(args...);
+    }
+#endif
+    template<typename Kernel, typename... Args>
+    auto simd_run_scalar(Args... args) {
+        return Kernel::template run<0>(args...);
+    }
+
+    template<typename Kernel, typename... Args>
+    auto simd_dispatch(Args... args) {
+        switch (detected_simd_level()) {
+#if TYPE_CONSTRAINTS_SIMD_DISPATCH
+            case simd_level::avx512: return simd_run_avx512<Kernel>(args...);
+            case simd_level::avx2: return simd_run_avx2<Kernel>(args...);
+            case simd_level::sse42: return simd_run_sse42<Kernel>(args...);
+#endif
+            default: return simd_run_scalar<Kernel>(args...);
+        }
+    }
+
+    template<typename Op>
+    struct elementwise_kernel {
+        template<size_t W, typename T, typename A, typename B>
+        [[gnu::always_inline]] static void run(A a, B b, T* out, size_t count) {
+            size_t i = 0;
+            if constexpr (W > 0) {
+                using V = vec<T, W>;
+                constexpr size_t lanes = W / sizeof(T);
+                for (; i + lanes <= count; i += lanes) {
+                    V va, vb, r;
+                    a.load(i, va);
+                    b.load(i, vb);
+                    Op::apply(r, va, vb);
+                    __builtin_memcpy(out + i, &r, W);
+                }
+            }
+            for (; i < count; i++) {
+                T r;
+                Op::apply(r, a.at(i), b.at(i));
+                out[i] = r;
+            }
+        }
+    };
+
+    template<typename T, typename U, size_t len>
+    const T* lanes_of(const safe_array<U, len>& arr) {
+        static_assert(is_lane_compatible<U, T>);
+        return reinterpret_cast<const T*>(arr.data());
+    }
+
+    // the kernels fill a plain T buffer which is then reinterpreted as the constrained result, so the
+    // result is neither default constructed first nor validated element by element afterwards
+    template<typename R, typename Op, signed_int T, size_t len, typename A, typename B>
+    safe_array<R, len> elementwise_to(A a, B b) {
+        static_assert(is_lane_compatible<R, T>);
+        std::array<T, len> raw;
+        simd_dispatch<elementwise_kernel<Op>>(a, b, raw.data(), len);
+        return std::bit_cast<safe_array<R, len>>(raw);
+    }
+
+    template<typename T, typename U, size_t len>
+    span_operand<T> lanes(const safe_array<U, len>& arr) { return span_operand<T>{ lanes_of<T>(arr) }; }
+
+    template<signed_int T, T n, T m>
+    broadcast_operand<T> lanes(InRange<T, n, m> s) { return broadcast_operand<T>{ s }; }
+}
+
+
+// array (op) array
+
+template<signed_int T, T n, T m, T nn, T mm, size_t len> requires (detail::sum_fits<T>(n, nn) && detail::sum_fits<T>(m, mm))
+safe_array<InRange<T, detail::bound_sum<T>(n, nn), detail::bound_sum<T>(m, mm)>, len> operator+(const safe_array<InRange<T, n, m>, len>& a, const safe_array<InRange<T, nn, mm>, len>& b) {
+    return detail::elementwise_to<InRange<T, detail::bound_sum<T>(n, nn), detail::bound_sum<T>(m, mm)>, detail::op_add, T, len>(detail::lanes<T>(a), detail::lanes<T>(b));
+}
+
+template<signed_int T, T n, T m, T nn, T mm, size_t len> requires (detail::difference_fits<T>(n, mm) && detail::difference_fits<T>(m, nn))
+safe_array<InRange<T, detail::bound_difference<T>(n, mm), detail::bound_difference<T>(m, nn)>, len> operator-(const safe_array<InRange<T, n, m>, len>& a, const safe_array<InRange<T, nn, mm>, len>& b) {
+    return detail::elementwise_to<InRange<T, detail::bound_difference<T>(n, mm), detail::bound_difference<T>(m, nn)>, detail::op_sub, T, len>(detail::lanes<T>(a), detail::lanes<T>(b));
+}
+
+template<signed_int T, T n, T m, T nn, T mm, size_t len>
+safe_array<InRange<T, std::min(n, nn), std::min(m, mm)>, len> elementwise_min(const safe_array<InRange<T, n, m>, len>& a, const safe_array<InRange<T, nn, mm>, len>& b) {
+    return detail::elementwise_to<InRange<T, std::min(n, nn), std::min(m, mm)>, detail::op_min, T, len>(detail::lanes<T>(a), detail::lanes<T>(b));
+}
+
+template<signed_int T, T n, T m, T nn, T mm, size_t len>
+safe_array<InRange<T, std::max(n, nn), std::max(m, mm)>, len> elementwise_max(const safe_array<InRange<T, n, m>, len>& a, const safe_array<InRange<T, nn, mm>, len>& b) {
+    return detail::elementwise_to<InRange<T, std::max(n, nn), std::max(m, mm)>, detail::op_max, T, len>(detail::lanes<T>(a), detail::lanes<T>(b));
+}
+
+template<signed_int T, T n, T m, T nn, T mm, size_t len>
+safe_array<lane_mask<T>, len> cmp_lt(const safe_array<InRange<T, n, m>, len>& a, const safe_array<InRange<T, nn, mm>, len>& b) {
+    return detail::elementwise_to<lane_mask<T>, detail::op_lt, T, len>(detail::lanes<T>(a), detail::lanes<T>(b));
+}
+
+template<signed_int T, T n, T m, T nn, T mm, size_t len>
+safe_array<lane_mask<T>, len> cmp_gt(const safe_array<InRange<T, n, m>, len>& a, const safe_array<InRange<T, nn, mm>, len>& b) {
+    return detail::elementwise_to<lane_mask<T>, detail::op_gt, T, len>(detail::lanes<T>(a), detail::lanes<T>(b));
+}
+
+template<signed_int T, T n, T m, T nn, T mm, size_t len>
+safe_array<lane_mask<T>, len> cmp_eq(const safe_array<InRange<T, n, m>, len>& a, const safe_array<InRange<T, nn, mm>, len>& b) {
+    return detail::elementwise_to<lane_mask<T>, detail::op_eq, T, len>(detail::lanes<T>(a), detail::lanes<T>(b));
+}
+
+
+// array (op) broadcast scalar and broadcast scalar (op) array
+
+template<signed_int T, T n, T m, T nn, T mm, size_t len> requires (detail::sum_fits<T>(n, nn) && detail::sum_fits<T>(m, mm))
+safe_array<InRange<T, detail::bound_sum<T>(n, nn), detail::bound_sum<T>(m, mm)>, len> operator+(const safe_array<InRange<T, n, m>, len>& a, InRange<T, nn, mm> s) {
+    return detail::elementwise_to<InRange<T, detail::bound_sum<T>(n, nn), detail::bound_sum<T>(m, mm)>, detail::op_add, T, len>(detail::lanes<T>(a), detail::lanes(s));
+}
+
+template<signed_int T, T n, T m, T nn, T mm, size_t len> requires (detail::sum_fits<T>(n, nn) && detail::sum_fits<T>(m, mm))
+safe_array<InRange<T, detail::bound_sum<T>(n, nn), detail::bound_sum<T>(m, mm)>, len> operator+(InRange<T, nn, mm> s, const safe_array<InRange<T, n, m>, len>& a) {
+    return a + s;
+}
+
+template<signed_int T, T n, T m, T nn, T mm, size_t len> requires (detail::difference_fits<T>(n, mm) && detail::difference_fits<T>(m, nn))
+safe_array<InRange<T, detail::bound_difference<T>(n, mm), detail::bound_difference<T>(m, nn)>, len> operator-(const safe_array<InRange<T, n, m>, len>& a, InRange<T, nn, mm> s) {
+    return detail::elementwise_to<InRange<T, detail::bound_difference<T>(n, mm), detail::bound_difference<T>(m, nn)>, detail::op_sub, T, len>(detail::lanes<T>(a), detail::lanes(s));
+}
+
+template<signed_int T, T n, T m, T nn, T mm, size_t len> requires (detail::difference_fits<T>(nn, m) && detail::difference_fits<T>(mm, n))
+safe_array<InRange<T, detail::bound_difference<T>(nn, m), detail::bound_difference<T>(mm, n)>, len> operator-(InRange<T, nn, mm> s, const safe_array<InRange<T, n, m>, len>& a) {
+    return detail::elementwise_to<InRange<T, detail::bound_difference<T>(nn, m), detail::bound_difference<T>(mm, n)>, detail::op_sub, T, len>(detail::lanes(s), detail::lanes<T>(a));
+}
+
+template<signed_int T, T n, T m, T nn, T mm, size_t len>
+safe_array<InRange<T, std::min(n, nn), std::min(m, mm)>, len> elementwise_min(const safe_array<InRange<T, n, m>, len>& a, InRange<T, nn, mm> s) {
+    return detail::elementwise_to<InRange<T, std::min(n, nn), std::min(m, mm)>, detail::op_min, T, len>(detail::lanes<T>(a), detail::lanes(s));
+}
+
+template<signed_int T, T n, T m, T nn, T mm, size_t len>
+safe_array<InRange<T, std::max(n, nn), std::max(m, mm)>, len> elementwise_max(const safe_array<InRange<T, n, m>, len>& a, InRange<T, nn, mm> s) {
+    return detail::elementwise_to<InRange<T, std::max(n, nn), std::max(m, mm)>, detail::op_max, T, len>(detail::lanes<T>(a), detail::lanes(s));
+}
+
+template<signed_int T, T n, T m, T nn, T mm, size_t len>
+safe_array<lane_mask<T>, len> cmp_lt(const safe_array<InRange<T, n, m>, len>& a, InRange<T, nn, mm> s) {
+    return detail::elementwise_to<lane_mask<T>, detail::op_lt, T, len>(detail::lanes<T>(a), detail::lanes(s));
+}
+
+template<signed_int T, T n, T m, T nn, T mm, size_t len>
+safe_array<lane_mask<T>, len> cmp_gt(const safe_array<InRange<T, n, m>, len>& a, InRange<T, nn, mm> s) {
+    return detail::elementwise_to<lane_mask<T>, detail::op_gt, T, len>(detail::lanes<T>(a), detail::lanes(s));
+}
+
+template<signed_int T, T n, T m, T nn, T mm, size_t len>
+safe_array<lane_mask<T>, len> cmp_eq(const safe_array<InRange<T, n, m>, len>& a, InRange<T, nn, mm> s) {
+    return detail::elementwise_to<lane_mask<T>, detail::op_eq, T, len>(detail::lanes<T>(a), detail::lanes(s));
+}
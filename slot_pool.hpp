@@ -0,0 +1,128 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include "int.hpp"
+
+
+// fixed capacity object pool. Live objects are kept densely packed (iteration walks a plain array), slots map stable
+// handles onto their current position. Handles pack the slot index and a generation into one 32 bit word, so a handle
+// to an erased object is rejected by a single generation compare. The generation is bumped on every insert and every
+// erase, so it is odd exactly while the slot is live and a handle can never match a free slot, even after the counter
+// wraps. Capacity is capped so that at least 16 bits are left for the generation, a stale handle only aliases a new
+// object after 2^15 reuses of its slot.
+template<typename T, size_t capacity> requires (capacity > 0 && capacity <= (size_t(1) << 16))
+class slot_pool {
+    public:
+        using index_type = InRange<uint32_t, 0, capacity - 1>;
+
+        static constexpr uint32_t index_bits = std::bit_width(capacity - 1) == 0 ? 1 : std::bit_width(capacity - 1);
+        static constexpr uint32_t index_mask = (uint32_t(1) << index_bits) - 1;
+        static constexpr uint32_t generation_mask = ~index_mask;
+        static constexpr uint32_t generation_step = index_mask + 1;
+
+        class handle {
+            private:
+                template<typename TT, size_t c> requires (c > 0 && c <= (size_t(1) << 16))
+                friend class slot_pool;
+                constexpr handle(uint32_t bits) : bits(bits) {}
+            public:
+                index_type index() const { return N<uint32_t>(bits & index_mask).template assume_in_range<0, capacity - 1>(); }
+                uint32_t generation() const { return bits & generation_mask; }
+                uint32_t raw() const { return bits; }
+                bool operator==(const handle&) const = default;
+            private:
+                uint32_t bits;
+        };
+
+        slot_pool() : free_head(0), live(0) {
+            for (size_t i = 0; i < capacity; i++) {
+                slots.data()[i] = slot{ 0, static_cast<uint32_t>(i + 1) };
+            }
+        }
+
+        template<typename... Args>
+        std::optional<handle> emplace(Args&&... args) {
+            if (live == capacity) return std::nullopt;
+
+            auto i = typed(free_head);
+            auto position = typed(live);
+            slot& s = slots[i];
+            free_head = s.position;
+            s.generation = (s.generation + generation_step) & generation_mask;
+            s.position = live;
+            values[position] = T(std::forward<Args>(args)...);
+            dense_to_slot[position] = N<uint32_t>(static_cast<uint32_t>(i)).template assume_in_range<0, capacity - 1>();
+            live++;
+            return handle(s.generation | static_cast<uint32_t>(i));
+        }
+
+        std::optional<handle> insert(T value) { return emplace(std::move(value)); }
+
+        bool erase(handle h) {
+            auto i = typed(h.index());
+            slot& s = slots[i];
+            if (s.generation != h.generation()) return false;
+
+            auto position = typed(s.position);
+            auto last = typed(live - 1);
+            if (position != last) {
+                values[position] = std::move(values[last]);
+                auto moved = dense_to_slot[last];
+                dense_to_slot[position] = moved;
+                slots[typed(moved)].position = s.position;
+            }
+            values[last] = T();
+            live--;
+
+            s.generation = (s.generation + generation_step) & generation_mask;
+            s.position = free_head;
+            free_head = static_cast<uint32_t>(i);
+            return true;
+        }
+
+        std::optional<safe_ptr<T>> get(handle h) {
+            const slot& s = slots[typed(h.index())];
+            if (s.generation != h.generation()) return std::nullopt;
+            return safe_ptr<T>(values[typed(s.position)]);
+        }
+        std::optional<safe_ptr<const T>> get(handle h) const {
+            const slot& s = slots[typed(h.index())];
+            if (s.generation != h.generation()) return std::nullopt;
+            return safe_ptr<const T>(values[typed(s.position)]);
+        }
+
+        bool contains(handle h) const { return slots[typed(h.index())].generation == h.generation(); }
+
+        size_t size() const { return live; }
+        bool empty() const { return live == 0; }
+        bool full() const { return live == capacity; }
+
+        // dense iteration over the live objects, in no particular order
+        T* begin() { return values.data(); }
+        T* end() { return values.data() + live; }
+        const T* begin() const { return values.data(); }
+        const T* end() const { return values.data() + live; }
+
+    private:
+        struct slot {
+            uint32_t generation; // already shifted into the generation bits of a handle, odd while live
+            uint32_t position;   // dense position while live, next free slot while free
+        };
+
+        // every stored slot index and dense position is < capacity by construction
+        static InRange<size_t, 0, capacity - 1> typed(uint32_t i) {
+            return N<size_t>(i).template assume_in_range<0, capacity - 1>();
+        }
+        static InRange<size_t, 0, capacity - 1> typed(index_type i) {
+            return typed(static_cast<uint32_t>(i));
+        }
+
+        safe_array<slot, capacity> slots;
+        safe_array<T, capacity> values;
+        safe_array<index_type, capacity> dense_to_slot;
+        uint32_t free_head;
+        uint32_t live;
+};